@@ -1,180 +1,259 @@
 #ifndef ALGORITHM_H
 #define ALGORITHM_H
 
-#include "Operator.h"   // class with operators definition
-#include "Parameters.h" // for accessing parameters set by the user interface
+#include "Operator.h"    // class with operators definition
+#include "Oscillators.h" // for the maximum number of unison lanes
+#include "Parameters.h"  // for accessing parameters set by the user interface
+
+/// Routing of an algorithm: a mask of modulating operators for every operator and
+/// a mask of output operators (bit i stands for operator i). An operator is only
+/// modulated by operators with higher indices. Feedback routes the output of one
+/// operator to the phase of an operator with the same or a higher index, using the
+/// mean of its two previous output samples.
+template <int numOperators>
+struct AlgorithmTopology
+{
+    unsigned int modulators[numOperators]; // masks of operators which modulate each operator
+    unsigned int outputs;                  // mask of output operators
+    int feedbackSource;                    // operator which output is fed back (-1 if there is no feedback)
+    int feedbackTarget;                    // operator which phase is modulated by the feedback
+};
+
+/// Algorithm sets for the supported numbers of operators.
+template <int numOperators>
+struct AlgorithmSet;
+
+/// Four operators: algorithms from Ableton's Operator (see README.md), without feedback.
+template <>
+struct AlgorithmSet<4>
+{
+    static constexpr int numAlgorithms = 11;
+    static constexpr AlgorithmTopology<4> topologies[numAlgorithms] = {
+        { { 2, 4, 8, 0 }, 1, -1, -1 },  // D -> C -> B -> A
+        { { 2, 12, 0, 0 }, 1, -1, -1 }, // (C + D) -> B -> A
+        { { 10, 4, 0, 0 }, 1, -1, -1 }, // (C -> B + D) -> A
+        { { 6, 8, 8, 0 }, 1, -1, -1 },  // D -> (B + C) -> A
+        { { 4, 4, 8, 0 }, 3, -1, -1 },  // D -> C -> (A, B)
+        { { 0, 4, 8, 0 }, 3, -1, -1 },  // D -> C -> B, A
+        { { 14, 0, 0, 0 }, 1, -1, -1 }, // (B + C + D) -> A
+        { { 2, 0, 8, 0 }, 5, -1, -1 },  // B -> A, D -> C
+        { { 8, 8, 8, 0 }, 7, -1, -1 },  // D -> (A, B, C)
+        { { 0, 0, 8, 0 }, 7, -1, -1 },  // D -> C, B, A
+        { { 0, 0, 0, 0 }, 15, -1, -1 }  // A, B, C, D
+    };
+};
+
+/// Six operators: the 32 DX7 algorithms (DX7 operator n is operator n - 1 here).
+template <>
+struct AlgorithmSet<6>
+{
+    static constexpr int numAlgorithms = 32;
+    static constexpr AlgorithmTopology<6> topologies[numAlgorithms] = {
+        { { 2, 0, 8, 16, 32, 0 }, 5, 5, 5 },   // 1
+        { { 2, 0, 8, 16, 32, 0 }, 5, 1, 1 },   // 2
+        { { 2, 4, 0, 16, 32, 0 }, 9, 5, 5 },   // 3
+        { { 2, 4, 0, 16, 32, 0 }, 9, 3, 5 },   // 4
+        { { 2, 0, 8, 0, 32, 0 }, 21, 5, 5 },   // 5
+        { { 2, 0, 8, 0, 32, 0 }, 21, 4, 5 },   // 6
+        { { 2, 0, 24, 0, 32, 0 }, 5, 5, 5 },   // 7
+        { { 2, 0, 24, 0, 32, 0 }, 5, 3, 3 },   // 8
+        { { 2, 0, 24, 0, 32, 0 }, 5, 1, 1 },   // 9
+        { { 2, 4, 0, 48, 0, 0 }, 9, 2, 2 },    // 10
+        { { 2, 4, 0, 48, 0, 0 }, 9, 5, 5 },    // 11
+        { { 2, 0, 56, 0, 0, 0 }, 5, 1, 1 },    // 12
+        { { 2, 0, 56, 0, 0, 0 }, 5, 5, 5 },    // 13
+        { { 2, 0, 8, 48, 0, 0 }, 5, 5, 5 },    // 14
+        { { 2, 0, 8, 48, 0, 0 }, 5, 1, 1 },    // 15
+        { { 22, 0, 8, 0, 32, 0 }, 1, 5, 5 },   // 16
+        { { 22, 0, 8, 0, 32, 0 }, 1, 1, 1 },   // 17
+        { { 14, 0, 0, 16, 32, 0 }, 1, 2, 2 },  // 18
+        { { 2, 4, 0, 32, 32, 0 }, 25, 5, 5 },  // 19
+        { { 4, 4, 0, 48, 0, 0 }, 11, 2, 2 },   // 20
+        { { 4, 4, 0, 32, 32, 0 }, 27, 2, 2 },  // 21
+        { { 2, 0, 32, 32, 32, 0 }, 29, 5, 5 }, // 22
+        { { 0, 4, 0, 32, 32, 0 }, 27, 5, 5 },  // 23
+        { { 0, 0, 32, 32, 32, 0 }, 31, 5, 5 }, // 24
+        { { 0, 0, 0, 32, 32, 0 }, 31, 5, 5 },  // 25
+        { { 0, 4, 0, 48, 0, 0 }, 11, 5, 5 },   // 26
+        { { 0, 4, 0, 48, 0, 0 }, 11, 2, 2 },   // 27
+        { { 2, 0, 8, 16, 0, 0 }, 37, 4, 4 },   // 28
+        { { 0, 0, 8, 0, 32, 0 }, 23, 5, 5 },   // 29
+        { { 0, 0, 8, 16, 0, 0 }, 39, 4, 4 },   // 30
+        { { 0, 0, 0, 0, 32, 0 }, 31, 5, 5 },   // 31
+        { { 0, 0, 0, 0, 0, 0 }, 63, 5, 5 }     // 32
+    };
+};
+
+/// Eight operators: the 32 DX7 algorithms on operators A-F with an additional
+/// two operator stack (H -> G) as an output.
+template <>
+struct AlgorithmSet<8>
+{
+    static constexpr int numAlgorithms = 32;
+    static constexpr AlgorithmTopology<8> topologies[numAlgorithms] = {
+        { { 2, 0, 8, 16, 32, 0, 128, 0 }, 69, 5, 5 },  // 1
+        { { 2, 0, 8, 16, 32, 0, 128, 0 }, 69, 1, 1 },  // 2
+        { { 2, 4, 0, 16, 32, 0, 128, 0 }, 73, 5, 5 },  // 3
+        { { 2, 4, 0, 16, 32, 0, 128, 0 }, 73, 3, 5 },  // 4
+        { { 2, 0, 8, 0, 32, 0, 128, 0 }, 85, 5, 5 },   // 5
+        { { 2, 0, 8, 0, 32, 0, 128, 0 }, 85, 4, 5 },   // 6
+        { { 2, 0, 24, 0, 32, 0, 128, 0 }, 69, 5, 5 },  // 7
+        { { 2, 0, 24, 0, 32, 0, 128, 0 }, 69, 3, 3 },  // 8
+        { { 2, 0, 24, 0, 32, 0, 128, 0 }, 69, 1, 1 },  // 9
+        { { 2, 4, 0, 48, 0, 0, 128, 0 }, 73, 2, 2 },   // 10
+        { { 2, 4, 0, 48, 0, 0, 128, 0 }, 73, 5, 5 },   // 11
+        { { 2, 0, 56, 0, 0, 0, 128, 0 }, 69, 1, 1 },   // 12
+        { { 2, 0, 56, 0, 0, 0, 128, 0 }, 69, 5, 5 },   // 13
+        { { 2, 0, 8, 48, 0, 0, 128, 0 }, 69, 5, 5 },   // 14
+        { { 2, 0, 8, 48, 0, 0, 128, 0 }, 69, 1, 1 },   // 15
+        { { 22, 0, 8, 0, 32, 0, 128, 0 }, 65, 5, 5 },  // 16
+        { { 22, 0, 8, 0, 32, 0, 128, 0 }, 65, 1, 1 },  // 17
+        { { 14, 0, 0, 16, 32, 0, 128, 0 }, 65, 2, 2 }, // 18
+        { { 2, 4, 0, 32, 32, 0, 128, 0 }, 89, 5, 5 },  // 19
+        { { 4, 4, 0, 48, 0, 0, 128, 0 }, 75, 2, 2 },   // 20
+        { { 4, 4, 0, 32, 32, 0, 128, 0 }, 91, 2, 2 },  // 21
+        { { 2, 0, 32, 32, 32, 0, 128, 0 }, 93, 5, 5 }, // 22
+        { { 0, 4, 0, 32, 32, 0, 128, 0 }, 91, 5, 5 },  // 23
+        { { 0, 0, 32, 32, 32, 0, 128, 0 }, 95, 5, 5 }, // 24
+        { { 0, 0, 0, 32, 32, 0, 128, 0 }, 95, 5, 5 },  // 25
+        { { 0, 4, 0, 48, 0, 0, 128, 0 }, 75, 5, 5 },   // 26
+        { { 0, 4, 0, 48, 0, 0, 128, 0 }, 75, 2, 2 },   // 27
+        { { 2, 0, 8, 16, 0, 0, 128, 0 }, 101, 4, 4 },  // 28
+        { { 0, 0, 8, 0, 32, 0, 128, 0 }, 87, 5, 5 },   // 29
+        { { 0, 0, 8, 16, 0, 0, 128, 0 }, 103, 4, 4 },  // 30
+        { { 0, 0, 0, 0, 32, 0, 128, 0 }, 95, 5, 5 },   // 31
+        { { 0, 0, 0, 0, 0, 0, 128, 0 }, 127, 5, 5 }    // 32
+    };
+};
 
 /// Algorithm class which defines phase modulation routing for operators.
+/// The number of operators is a template parameter, so all loops over
+/// operators have a fixed number of iterations and feedback processing
+/// is only compiled for algorithm sets which have feedback. Operators are
+/// processed from the last one to the first one. Phase offset of an operator
+/// is the mean of its modulators and the algorithm output is the mean of
+/// its output operators.
+template <int numOperators>
 class Algorithm
 {
 public:
+    static_assert (AlgorithmSet<numOperators>::numAlgorithms == Parameters::getNumAlgorithms (numOperators),
+                   "parameter layout doesn't match the algorithm set");
+
     /// process algorithm
     /// @param Operator*, array with operators
-    /// @param bool*, empty bool array (should be the same size as the operators array);
-    ///               array gets overwritten: true means the operator outputs sound,
-    ///                                       false means the operator modulates another.
-    /// @return float, output sample
-    float process (Operator* ops, bool* isOutput)
+    /// @param int, sample index in the current modulation block
+    /// @param float*, output sample for each unison lane
+    template <int numLanes>
+    void process (Operator* ops, int n, float* out)
     {
-        float algorithmOut = 0.0f;
-        float opSampleA, opSampleB, opSampleC, opSampleD;
+        float opOut[numOperators][UnisonOsc::maxLanes]; // operators' outputs for each lane
+        for (int i = numOperators - 1; i >= 0; i--)
+        {
+            float phaseOffset[numLanes] = {};
+            for (int j = i + 1; j < numOperators; j++)
+            {
+                if ((modulators[i] >> j) & 1u)
+                {
+                    for (int k = 0; k < numLanes; k++)
+                        phaseOffset[k] += opOut[j][k];
+                }
+            }
+            for (int k = 0; k < numLanes; k++)
+                phaseOffset[k] *= modulatorScale[i];
+            if constexpr (hasFeedback)
+            {
+                if (i == feedbackTarget)
+                {
+                    for (int k = 0; k < numLanes; k++)
+                        phaseOffset[k] += feedbackScale * (feedback[0][k] + feedback[1][k]);
+                }
+            }
+            ops[i].process<numLanes> (n, phaseOffset, opOut[i]);
+            if constexpr (hasFeedback)
+            {
+                if (i == feedbackSource)
+                {
+                    for (int k = 0; k < numLanes; k++)
+                    {
+                        feedback[1][k] = feedback[0][k];
+                        feedback[0][k] = opOut[i][k];
+                    }
+                }
+            }
+        }
+        for (int k = 0; k < numLanes; k++)
+            out[k] = 0.0f;
         for (int i = 0; i < numOperators; i++)
-            isOutput[i] = false;
-        // switch to specified algorithm
-        switch (algorithm)
         {
-        case 0:
-            // specify output operators
-            isOutput[0] = true;
-            // process algorithm
-            opSampleD = ops[3].process();
-            ops[2].setOscPhaseOffset (opSampleD);
-            opSampleC = ops[2].process();
-            ops[1].setOscPhaseOffset (opSampleC);
-            opSampleB = ops[1].process();
-            ops[0].setOscPhaseOffset (opSampleB);
-            algorithmOut = ops[0].process();
-            break;
-        case 1:
-            // specify output operators
-            isOutput[0] = true;
-            // process algorithm
-            opSampleD = ops[3].process();
-            opSampleC = ops[2].process();
-            ops[1].setOscPhaseOffset ((opSampleC + opSampleD) / 2);
-            opSampleB = ops[1].process();
-            ops[0].setOscPhaseOffset (opSampleB);
-            algorithmOut = ops[0].process();
-            break;
-        case 2:
-            // specify output operators
-            isOutput[0] = true;
-            // process algorithm
-            opSampleD = ops[3].process();
-            opSampleC = ops[2].process();
-            ops[1].setOscPhaseOffset (opSampleC);
-            opSampleB = ops[1].process();
-            ops[0].setOscPhaseOffset ((opSampleB + opSampleD) / 2);
-            algorithmOut = ops[0].process();
-            break;
-        case 3:
-            // specify output operators
-            isOutput[0] = true;
-            // process algorithm
-            opSampleD = ops[3].process();
-            ops[2].setOscPhaseOffset (opSampleD);
-            opSampleC = ops[2].process();
-            ops[1].setOscPhaseOffset (opSampleD);
-            opSampleB = ops[1].process();
-            ops[0].setOscPhaseOffset ((opSampleB + opSampleC) / 2);
-            algorithmOut = ops[0].process();
-            break;
-        case 4:
-            // specify output operators
-            isOutput[0] = true;
-            isOutput[1] = true;
-            // process algorithm
-            opSampleD = ops[3].process();
-            ops[2].setOscPhaseOffset (opSampleD);
-            opSampleC = ops[2].process();
-            ops[1].setOscPhaseOffset (opSampleC);
-            opSampleB = ops[1].process();
-            ops[0].setOscPhaseOffset (opSampleC);
-            opSampleA = ops[0].process();
-            algorithmOut = (opSampleA + opSampleB) / 2;
-            break;
-        case 5:
-            // specify output operators
-            isOutput[0] = true;
-            isOutput[1] = true;
-            // process algorithm
-            opSampleD = ops[3].process();
-            ops[2].setOscPhaseOffset (opSampleD);
-            opSampleC = ops[2].process();
-            ops[1].setOscPhaseOffset (opSampleC);
-            opSampleB = ops[1].process();
-            opSampleA = ops[0].process();
-            algorithmOut = (opSampleA + opSampleB) / 2;
-            break;
-        case 6:
-            // specify output operators
-            isOutput[0] = true;
-            // process algorithm
-            opSampleD = ops[3].process();
-            opSampleC = ops[2].process();
-            opSampleB = ops[1].process();
-            ops[0].setOscPhaseOffset ((opSampleB + opSampleC + opSampleD) / 3);
-            algorithmOut = ops[0].process();
-            break;
-        case 7:
-            // specify output operators
-            isOutput[0] = true;
-            isOutput[2] = true;
-            // process algorithm
-            opSampleD = ops[3].process();
-            ops[2].setOscPhaseOffset (opSampleD);
-            opSampleC = ops[2].process();
-            opSampleB = ops[1].process();
-            ops[0].setOscPhaseOffset (opSampleB);
-            opSampleA = ops[0].process();
-            algorithmOut = (opSampleA + opSampleC) / 2;
-            break;
-        case 8:
-            // specify output operators
-            isOutput[0] = true;
-            isOutput[1] = true;
-            isOutput[2] = true;
-            // process algorithm
-            opSampleD = ops[3].process();
-            ops[2].setOscPhaseOffset (opSampleD);
-            opSampleC = ops[2].process();
-            ops[1].setOscPhaseOffset (opSampleD);
-            opSampleB = ops[1].process();
-            ops[0].setOscPhaseOffset (opSampleD);
-            opSampleA = ops[0].process();
-            algorithmOut = (opSampleA + opSampleB + opSampleC) / 3;
-            break;
-        case 9:
-            // specify output operators
-            isOutput[0] = true;
-            isOutput[1] = true;
-            isOutput[2] = true;
-            // process algorithm
-            opSampleD = ops[3].process();
-            ops[2].setOscPhaseOffset (opSampleD);
-            opSampleC = ops[2].process();
-            opSampleB = ops[1].process();
-            opSampleA = ops[0].process();
-            algorithmOut = (opSampleA + opSampleB + opSampleC) / 3;
-            break;
-        case 10:
-            // specify output operators
-            isOutput[0] = true;
-            isOutput[1] = true;
-            isOutput[2] = true;
-            isOutput[3] = true;
-            // process algorithm
-            opSampleD = ops[3].process();
-            opSampleC = ops[2].process();
-            opSampleB = ops[1].process();
-            opSampleA = ops[0].process();
-            algorithmOut = (opSampleA + opSampleB + opSampleC + opSampleD) / 4;
-            break;
+            if ((outputs >> i) & 1u)
+            {
+                for (int k = 0; k < numLanes; k++)
+                    out[k] += opOut[i][k];
+            }
         }
-        return algorithmOut;
+        for (int k = 0; k < numLanes; k++)
+            out[k] *= outputScale;
+    }
+
+    /// check if an operator outputs sound in the current algorithm
+    /// @param int, operator index
+    /// @return bool, true if the operator outputs sound, false if it modulates another one
+    bool isOutput (int _opIdx) const
+    {
+        return (outputs >> _opIdx) & 1u;
     }
 
     /// initialises algorithm per each note
-    /// @param Parameters*, pointer to the parameters class (that contains 
-    ///                     algorithm number and number of operators)
-    void startNote (Parameters* _param)
+    /// @param int, algorithm index
+    /// @param float, feedback amount (only for algorithm sets with feedback)
+    void startNote (int _algorithm, float _feedback)
     {
-        algorithm = *_param->algorithm;
-        numOperators = _param->numOperators;
+        int algorithm = juce::jlimit (0, AlgorithmSet<numOperators>::numAlgorithms - 1, _algorithm);
+        const AlgorithmTopology<numOperators>& topology = AlgorithmSet<numOperators>::topologies[algorithm];
+        for (int i = 0; i < numOperators; i++)
+        {
+            modulators[i] = topology.modulators[i];
+            int numModulators = countBits (modulators[i]);
+            modulatorScale[i] = numModulators > 0 ? 1.0f / float (numModulators) : 0.0f;
+        }
+        outputs = topology.outputs;
+        outputScale = 1.0f / float (countBits (outputs));
+        if constexpr (hasFeedback)
+        {
+            feedbackSource = topology.feedbackSource;
+            feedbackTarget = topology.feedbackTarget;
+            feedbackScale = 0.5f * _feedback; // mean of two previous samples
+            for (int k = 0; k < UnisonOsc::maxLanes; k++)
+            {
+                feedback[0][k] = 0.0f;
+                feedback[1][k] = 0.0f;
+            }
+        }
     }
 private:
-    int algorithm;    // algorithm number
-    int numOperators; // number of operators
+    static constexpr bool hasFeedback = numOperators > 4; // flag for algorithm sets with feedback
+
+    unsigned int modulators[numOperators];           // masks of operators which modulate each operator
+    float modulatorScale[numOperators];              // scale for the sum of modulators for each operator
+    unsigned int outputs = 0;                        // mask of output operators
+    float outputScale = 1.0f;                        // scale for the sum of output operators
+    // feedback (is used only if the algorithm set has feedback)
+    int feedbackSource = -1;                         // operator which output is fed back
+    int feedbackTarget = -1;                         // operator which phase is modulated by the feedback
+    float feedbackScale = 0.0f;                      // feedback amount applied to the sum of two previous samples
+    float feedback[2][UnisonOsc::maxLanes] = {};     // two previous output samples of the feedback source for each lane
+
+    /// count set bits in a mask
+    /// @param unsigned int, mask
+    /// @return int, number of set bits
+    static int countBits (unsigned int _mask)
+    {
+        int count = 0;
+        for (; _mask != 0; _mask >>= 1)
+            count += int (_mask & 1u);
+        return count;
+    }
 };
 
 #endif // ALGORITHM_H
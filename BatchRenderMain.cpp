@@ -0,0 +1,52 @@
+/*
+  ==============================================================================
+
+    Command line batch renderer. Build it as a console application together
+    with the plugin sources and PMSYNTH_BATCH_RENDER=1 in preprocessor definitions:
+
+        PMSynthRender manifest.json [number of threads]
+
+  ==============================================================================
+*/
+
+#if PMSYNTH_BATCH_RENDER
+
+#include "BatchRenderer.h"
+#include <iostream> // for std::cout and std::cerr
+
+int main (int argc, char* argv[])
+{
+    if (argc < 2)
+    {
+        std::cerr << "usage: " << argv[0] << " manifest.json [number of threads]" << std::endl;
+        return 1;
+    }
+    // processors use timers and background threads, which need the message manager
+    juce::ScopedJuceInitialiser_GUI juceInitialiser;
+    std::vector<BatchRenderer::Job> jobs;
+    juce::String error = BatchRenderer::readManifest (juce::File::getCurrentWorkingDirectory().getChildFile (argv[1]), jobs);
+    if (error.isNotEmpty())
+    {
+        std::cerr << error << std::endl;
+        return 1;
+    }
+    BatchRenderer renderer (argc > 2 ? juce::String (argv[2]).getIntValue() : 0);
+    std::cout << "rendering " << jobs.size() << " jobs on " << renderer.getNumWorkers() << " threads with "
+              << SimdDispatch::getTierName (SimdDispatch::selectTier()) << " kernels" << std::endl;
+    juce::int64 startTicks = juce::Time::getHighResolutionTicks();
+    std::vector<BatchRenderer::Result> results = renderer.render (jobs);
+    double wallSeconds = juce::Time::highResolutionTicksToSeconds (juce::Time::getHighResolutionTicks() - startTicks);
+    std::cout << BatchRenderer::makeReport (jobs, results, wallSeconds);
+   #if PMSYNTH_REALTIME_CHECK
+    // the jobs double as real-time safety scenarios (violations are reported on stderr with stack traces)
+    std::cout << "real-time violations: " << RealtimeChecker::getNumViolations() << std::endl;
+    if (RealtimeChecker::getNumViolations() > 0)
+        return 1;
+   #endif
+    for (auto& result : results)
+        if (result.error.isNotEmpty())
+            return 1;
+    return 0;
+}
+
+#endif // PMSYNTH_BATCH_RENDER
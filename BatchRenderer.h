@@ -0,0 +1,254 @@
+#ifndef BATCH_RENDERER_H
+#define BATCH_RENDERER_H
+
+#include <JuceHeader.h>          // for JUCE classes
+#include <atomic>                // for std::atomic
+#include <memory>                // for unique_ptr
+#include <vector>                // for std::vector
+#include "PluginProcessor.h"     // for the synthesizer processor
+
+/// Batch renderer class.
+/// A class instance renders jobs of a manifest (each job is a plugin state, a MIDI file,
+/// a sample rate and an output WAV file) concurrently on all cores. Each worker thread
+/// owns one processor, which is created up front and reused for all jobs the worker takes,
+/// and workers take jobs from a shared counter, so long and short jobs are balanced.
+/// Jobs are rendered in non-realtime mode (offline quality, effects allocated in place).
+class BatchRenderer
+{
+public:
+    /// render job
+    struct Job
+    {
+        juce::File stateFile;    // plugin state saved by getStateInformation()
+        juce::File midiFile;     // standard MIDI file
+        double sampleRate = 0.0; // sample rate [Hz]
+        juce::File outputFile;   // output WAV file
+    };
+
+    /// render result of a job
+    struct Result
+    {
+        double audioSeconds = 0.0;  // length of the rendered audio [sec]
+        double renderSeconds = 0.0; // time spent rendering [sec]
+        juce::String error;         // error message (empty for rendered jobs)
+
+        /// get realtime factor of the job
+        /// @return double, rendered audio length divided by the render time
+        double getRealtimeFactor() const
+        {
+            return renderSeconds > 0.0 ? audioSeconds / renderSeconds : 0.0;
+        }
+    };
+
+    /// constructor which creates worker processors
+    /// @param int, number of worker threads (0 for the number of cores)
+    BatchRenderer (int _numWorkers = 0)
+    {
+        int numWorkers = _numWorkers > 0 ? _numWorkers : juce::SystemStats::getNumCpus();
+        for (int i = 0; i < numWorkers; i++)
+            workers.push_back (std::make_unique<Worker> (*this, i));
+    }
+
+    /// read jobs from a manifest, which is a JSON array of objects with "state", "midi",
+    /// "sampleRate" and "output" properties (relative paths start from the manifest directory)
+    /// @param const juce::File&, manifest file
+    /// @param std::vector<Job>&, jobs read from the manifest
+    /// @return juce::String, error message (empty if all jobs were read)
+    static juce::String readManifest (const juce::File& _manifest, std::vector<Job>& _jobs)
+    {
+        juce::var manifest;
+        juce::Result result = juce::JSON::parse (_manifest.loadFileAsString(), manifest);
+        if (result.failed())
+            return "can't parse " + _manifest.getFullPathName() + ": " + result.getErrorMessage();
+        if (manifest.isArray() == false)
+            return _manifest.getFullPathName() + " should contain an array of jobs";
+        juce::File directory = _manifest.getParentDirectory();
+        for (auto& item : *manifest.getArray())
+        {
+            Job job;
+            job.stateFile = directory.getChildFile (item["state"].toString());
+            job.midiFile = directory.getChildFile (item["midi"].toString());
+            job.sampleRate = item.getProperty ("sampleRate", defaultSampleRate);
+            job.outputFile = directory.getChildFile (item["output"].toString());
+            if (job.sampleRate <= 0.0)
+                return "job " + juce::String (int (_jobs.size()) + 1) + " has an invalid sample rate";
+            _jobs.push_back (job);
+        }
+        return {};
+    }
+
+    /// render jobs (blocks until all jobs are rendered)
+    /// @param const std::vector<Job>&, jobs
+    /// @return std::vector<Result>, results in the order of jobs
+    std::vector<Result> render (const std::vector<Job>& _jobs)
+    {
+        jobs = &_jobs;
+        results.assign (_jobs.size(), Result());
+        nextJob.store (0);
+        for (auto& worker : workers)
+            worker->startThread();
+        for (auto& worker : workers)
+            worker->waitForThreadToExit (-1);
+        jobs = nullptr;
+        return results;
+    }
+
+    /// get number of worker threads
+    /// @return int, number of workers
+    int getNumWorkers() const
+    {
+        return int (workers.size());
+    }
+
+    /// make a report with per-job and aggregate realtime factors
+    /// @param const std::vector<Job>&, jobs
+    /// @param const std::vector<Result>&, results of the jobs
+    /// @param double, wall-clock time of the whole batch [sec]
+    /// @return juce::String, report
+    static juce::String makeReport (const std::vector<Job>& _jobs, const std::vector<Result>& _results, double _wallSeconds)
+    {
+        juce::String report;
+        double audioSeconds = 0.0, renderSeconds = 0.0;
+        int numFailed = 0;
+        for (size_t i = 0; i < _jobs.size(); i++)
+        {
+            const Result& result = _results[i];
+            report << _jobs[i].outputFile.getFileName() << ": ";
+            if (result.error.isNotEmpty())
+            {
+                report << "failed (" << result.error << ")\n";
+                numFailed++;
+                continue;
+            }
+            report << juce::String (result.audioSeconds, 2) << " s of audio in " << juce::String (result.renderSeconds, 2)
+                   << " s, " << juce::String (result.getRealtimeFactor(), 1) << "x realtime\n";
+            audioSeconds += result.audioSeconds;
+            renderSeconds += result.renderSeconds;
+        }
+        // per-thread factor shows the processor speed, wall-clock factor includes the parallel speedup
+        report << "total: " << int (_jobs.size()) - numFailed << " jobs rendered, " << numFailed << " failed, "
+               << juce::String (audioSeconds, 2) << " s of audio in " << juce::String (_wallSeconds, 2) << " s\n"
+               << "realtime factor: " << juce::String (renderSeconds > 0.0 ? audioSeconds / renderSeconds : 0.0, 1)
+               << "x per thread, " << juce::String (_wallSeconds > 0.0 ? audioSeconds / _wallSeconds : 0.0, 1) << "x wall-clock\n";
+        return report;
+    }
+
+private:
+    static constexpr int blockSize = 512;                // render block size [samples]
+    static constexpr int numChannels = 2;                // number of output channels
+    static constexpr int bitsPerSample = 24;             // output WAV bit depth
+    static constexpr double defaultSampleRate = 48000.0; // sample rate for jobs which don't set it [Hz]
+    static constexpr double maxTailSeconds = 30.0;       // maximum length rendered after the last MIDI event [sec]
+    static constexpr double silenceSeconds = 0.5;        // length of silence which ends a job after the last MIDI event [sec]
+    static constexpr float silenceThreshold = 1e-5f;     // magnitude of samples considered silent
+
+    /// worker thread with its own processor
+    class Worker : public juce::Thread
+    {
+    public:
+        /// constructor which creates the processor
+        /// @param BatchRenderer&, renderer which owns the jobs
+        /// @param int, worker index
+        Worker (BatchRenderer& _renderer, int _index) :
+            juce::Thread ("Batch render " + juce::String (_index)),
+            renderer (_renderer),
+            processor (std::make_unique<PMSynthAudioProcessor>())
+        {
+        }
+
+        /// render jobs until none are left
+        void run() override
+        {
+            const std::vector<Job>& jobs = *renderer.jobs;
+            for (size_t i = renderer.nextJob.fetch_add (1); i < jobs.size() && ! threadShouldExit(); i = renderer.nextJob.fetch_add (1))
+                renderer.results[i] = renderJob (*processor, jobs[i]);
+        }
+
+    private:
+        BatchRenderer& renderer;                          // renderer which owns the jobs
+        std::unique_ptr<PMSynthAudioProcessor> processor; // processor reused for all jobs of this worker
+    };
+
+    std::vector<std::unique_ptr<Worker>> workers; // worker threads
+    const std::vector<Job>* jobs = nullptr;       // jobs being rendered
+    std::vector<Result> results;                  // results of the jobs (each is written by one worker)
+    std::atomic<size_t> nextJob { 0 };            // index of the next job to take
+
+    /// render a job with a processor
+    /// @param PMSynthAudioProcessor&, processor
+    /// @param const Job&, job
+    /// @return Result, render result
+    static Result renderJob (PMSynthAudioProcessor& _processor, const Job& _job)
+    {
+        Result result;
+        // read the state and MIDI events (tracks are merged, timestamps are converted to seconds)
+        juce::MemoryBlock state;
+        if (_job.stateFile.loadFileAsData (state) == false)
+        {
+            result.error = "can't read " + _job.stateFile.getFullPathName();
+            return result;
+        }
+        juce::FileInputStream midiStream (_job.midiFile);
+        juce::MidiFile midiFile;
+        if (midiStream.openedOk() == false || midiFile.readFrom (midiStream) == false)
+        {
+            result.error = "can't read " + _job.midiFile.getFullPathName();
+            return result;
+        }
+        midiFile.convertTimestampTicksToSeconds();
+        juce::MidiMessageSequence sequence;
+        for (int i = 0; i < midiFile.getNumTracks(); i++)
+            sequence.addSequence (*midiFile.getTrack (i), 0.0);
+        // open the output file
+        _job.outputFile.deleteFile();
+        std::unique_ptr<juce::OutputStream> stream (_job.outputFile.createOutputStream());
+        juce::WavAudioFormat wavFormat;
+        std::unique_ptr<juce::AudioFormatWriter> writer;
+        if (stream != nullptr)
+            writer.reset (wavFormat.createWriterFor (stream.get(), _job.sampleRate, numChannels, bitsPerSample, {}, 0));
+        if (writer == nullptr)
+        {
+            result.error = "can't write " + _job.outputFile.getFullPathName();
+            return result;
+        }
+        stream.release(); // the writer owns the stream
+        // prepare the processor from a clean state
+        _processor.setNonRealtime (true);
+        _processor.setPlayConfigDetails (0, numChannels, _job.sampleRate, blockSize);
+        _processor.prepareToPlay (_job.sampleRate, blockSize);
+        _processor.reset();
+        _processor.setStateInformation (state.getData(), int (state.getSize()));
+        // render until the output is silent after the last event
+        juce::AudioBuffer<float> buffer (numChannels, blockSize);
+        juce::MidiBuffer midi;
+        juce::int64 lastEventSample = juce::int64 (sequence.getEndTime() * _job.sampleRate);
+        juce::int64 maxLength = lastEventSample + juce::int64 (maxTailSeconds * _job.sampleRate);
+        juce::int64 silenceLength = juce::int64 (silenceSeconds * _job.sampleRate);
+        juce::int64 position = 0, silentSamples = 0;
+        int eventIndex = 0;
+        juce::int64 startTicks = juce::Time::getHighResolutionTicks();
+        while (position < maxLength && silentSamples < silenceLength)
+        {
+            midi.clear();
+            for (; eventIndex < sequence.getNumEvents(); eventIndex++)
+            {
+                const juce::MidiMessage& message = sequence.getEventPointer (eventIndex)->message;
+                juce::int64 eventSample = juce::int64 (message.getTimeStamp() * _job.sampleRate);
+                if (eventSample >= position + blockSize)
+                    break;
+                if (message.isMetaEvent() == false)
+                    midi.addEvent (message, int (juce::jmax (juce::int64 (0), eventSample - position)));
+            }
+            _processor.processBlock (buffer, midi);
+            writer->writeFromAudioSampleBuffer (buffer, 0, blockSize);
+            position += blockSize;
+            if (position > lastEventSample)
+                silentSamples = buffer.getMagnitude (0, blockSize) < silenceThreshold ? silentSamples + blockSize : 0;
+        }
+        result.renderSeconds = juce::Time::highResolutionTicksToSeconds (juce::Time::getHighResolutionTicks() - startTicks);
+        result.audioSeconds = double (position) / _job.sampleRate;
+        return result;
+    }
+};
+
+#endif // BATCH_RENDERER_H
@@ -3,13 +3,19 @@
 
 #include <JuceHeader.h> // for juce::SmoothedValue
 #include <cmath>        // for rounding functions
-#include <memory>       // for unique_ptr
-#include "Parameters.h" // for accessing parameters set by the user interface
+#include <memory>         // for unique_ptr
+#include <limits>         // for std::numeric_limits
+#include "Parameters.h"   // for accessing parameters set by the user interface
+#include "LazyResource.h" // for allocating delay lines on demand
+#include "SimdDispatch.h" // for kernels compiled for SIMD tiers
 
 /// Delay class.
 /// A class instance stores samples into a buffer of a maximum delay
 /// size and outputs them with a specified delay time. Can process
-/// both mono and stereo audio input.
+/// both mono and stereo audio input. Delay lines are allocated on a
+/// background thread when the delay is switched on and are released
+/// after the delay has been switched off for a while. Processing is
+/// skipped while the input is silent and delay lines hold only silence.
 class Delay
 {
 public:
@@ -17,7 +23,8 @@ public:
     /// @param Parameters*, pointer to the parameters class
     Delay (Parameters* _param) :
         param(_param),
-        minDelayTime(_param->apvts.getParameterRange("delayTimeLeft").start), maxDelayTime(_param->apvts.getParameterRange("delayTimeLeft").end)
+        minDelayTime(_param->apvts.getParameterRange("delayTimeLeft").start), maxDelayTime(_param->apvts.getParameterRange("delayTimeLeft").end),
+        delayLines (releaseTimeMs)
     {
     }
 
@@ -25,10 +32,14 @@ public:
     /// @param float, sample rate [Hz]
     void prepareToPlay (float _sampleRate)
     {
-        // update delay line size
+        // update delay line size (delay lines are allocated when the delay is switched on)
         (*this).setSampleRate (_sampleRate);
         sizeInSamples = int(std::ceil (maxDelayTime * sampleRate));
-        allocateBuffers();
+        int size = sizeInSamples;
+        delayLines.prepare ([size] { return std::make_unique<DelayLines> (size); });
+        buffer[0] = buffer[1] = nullptr;
+        writeIndex = -1;
+        samplesSinceLoudWrite = sizeInSamples;
         // initialise smoothed parameters
         smoothedDryWet.reset (_sampleRate, 0.2f);
         smoothedDryWet.setCurrentAndTargetValue (0.0f);
@@ -41,6 +52,39 @@ public:
         }
     }
 
+    /// set non-realtime mode (the delay lines are allocated in place instead of on the background thread)
+    /// @param bool, flag for non-realtime rendering
+    void setNonRealtime (bool _isNonRealtime)
+    {
+        delayLines.setSynchronous (_isNonRealtime);
+    }
+
+    /// get length of the delay tail for the current parameters
+    /// @return double, time until the delayed signal decays below the silence threshold [sec]
+    double getTailLengthSeconds() const
+    {
+        if (*param->delayOnParam == false)
+            return 0.0;
+        float feedbackValue = *param->delayFeedbackParam;
+        if (feedbackValue >= 1.0f)
+            return std::numeric_limits<double>::infinity();
+        float delayTime = *param->delayTimeParam[0];
+        if (*param->delayTimeLinkParam == false)
+            delayTime = juce::jmax (delayTime, float (*param->delayTimeParam[1]));
+        // each repeat is attenuated by the feedback
+        double numRepeats = 1.0;
+        if (feedbackValue > 0.0f)
+            numRepeats += std::ceil (std::log (double (silenceThreshold)) / std::log (double (feedbackValue)));
+        return numRepeats * delayTime;
+    }
+
+    /// free delay lines
+    void releaseResources()
+    {
+        delayLines.releaseNow();
+        buffer[0] = buffer[1] = nullptr;
+    }
+
     /// apply delay to an audio buffer
     /// @param juce::AudioBuffer&, input audio buffer with samples
     /// @param int, number of samples in the buffer
@@ -49,17 +93,54 @@ public:
         // check on/off switch
         if (*param->delayOnParam == false)
         {
-            if (areBuffersClear == false)
-                clearBuffers();
+            isOn = false;
+            return;
+        }
+        // get delay lines (the output is dry until they are allocated)
+        DelayLines* lines = delayLines.acquire();
+        if (lines == nullptr)
+        {
+            delayLines.finishUse();
+            return;
+        }
+        if (lines->buffer[0].get() != buffer[0])
+        {
+            // new delay lines are allocated clear
+            buffer[0] = lines->buffer[0].get();
+            buffer[1] = lines->buffer[1].get();
+            areBuffersClear = true;
+            samplesSinceLoudWrite = sizeInSamples;
+        }
+        else if (isOn == false && areBuffersClear == false)
+        {
+            // clear delay lines which were used before the delay was switched off
+            clearBuffers();
+        }
+        isOn = true;
+        // skip processing while the input is silent and delay lines contain only silence
+        if (samplesSinceLoudWrite >= sizeInSamples && outputBuffer.getMagnitude (0, numSamples) < silenceThreshold)
+        {
+            delayLines.finishUse();
             return;
         }
         areBuffersClear = false;
-        // process delay
-        int numChannels = outputBuffer.getNumChannels();
-        if (numChannels == 1)
-            processMono (outputBuffer.getWritePointer (0), numSamples);
-        else if (numChannels == 2)
-            processStereo (outputBuffer.getWritePointer (0), outputBuffer.getWritePointer (1), numSamples);
+        // process delay with the kernel for the SIMD tier
+#if PMSYNTH_SIMD_DISPATCH
+        if (simdTier == SimdDispatch::avx512Tier)
+            processChannelsAvx512 (outputBuffer, numSamples);
+        else if (simdTier == SimdDispatch::avx2Tier)
+            processChannelsAvx2 (outputBuffer, numSamples);
+        else
+#endif
+            processChannels (outputBuffer, numSamples);
+        delayLines.finishUse();
+    }
+
+    /// set SIMD tier of the delay kernel
+    /// @param int, tier (see SimdDispatch.h)
+    void setSimdTier (int _simdTier)
+    {
+        simdTier = _simdTier;
     }
 
 private:
@@ -69,8 +150,12 @@ private:
     int writeIndex = -1;                             // write location in a buffer
     float dryWet = 0;                                // dry/wet
     float feedback = 0;                              // feedback
-    std::unique_ptr<float[]> buffer[2] = {nullptr};  // unique_ptr that manages a dynamically-allocated delay line (data is deleted automatically when goes out of scope)
+    float* buffer[2] = {nullptr};                    // delay lines used in the current block
     bool areBuffersClear = false;                    // flag for clear buffers state
+    bool isOn = false;                               // flag for delay switched on in the previous block
+    int samplesSinceLoudWrite = 0;                   // number of samples since a sample above the silence threshold was written to delay lines
+    int simdTier = SimdDispatch::sse2Tier;           // SIMD tier of the delay kernel
+    static constexpr float silenceThreshold = 1e-5f; // level below which signal is treated as silence (-100 dBFS)
     // parameters
     Parameters* param;                               // pointer to parameters set by the user interface
     const float minDelayTime;                        // minimum delay time [sec]
@@ -79,6 +164,23 @@ private:
     juce::SmoothedValue<float> smoothedDryWet;       // smoothed dry/wet
     juce::SmoothedValue<float> smoothedDelayTime[2]; // smoothed delay time for each channel
     juce::SmoothedValue<float> smoothedFeedback;     // smootehd feedback
+    // delay lines memory
+    static constexpr int releaseTimeMs = 30000;      // time after which unused delay lines are released [ms]
+
+    /// delay lines for left and right channels
+    struct DelayLines
+    {
+        /// allocate clear delay lines
+        /// @param int, size [samples]
+        DelayLines (int size)
+        {
+            for (int i = 0; i < 2; i++)
+                buffer[i].reset (new float[size]());
+        }
+
+        std::unique_ptr<float[]> buffer[2]; // unique_ptr that manages a dynamically-allocated delay line
+    };
+    LazyResource<DelayLines> delayLines;             // delay lines allocated on demand
 
     /// set sample rate
     /// @param float, sample rate
@@ -88,14 +190,6 @@ private:
         sampleRate = _sampleRate;
     }
 
-    /// allocate buffers for delay lines
-    void allocateBuffers()
-    {
-        for (int i = 0; i < 2; i++)
-            buffer[i].reset (new float[sizeInSamples]);
-        clearBuffers();
-    }
-
     /// clear buffers for delay lines
     void clearBuffers()
     {
@@ -105,6 +199,7 @@ private:
                 buffer[i][j] = 0.0f;
         }
         areBuffersClear = true;
+        samplesSinceLoudWrite = sizeInSamples;
     }
 
     /// process delay line sample by sample
@@ -130,7 +225,10 @@ private:
         while (readTimeInSamples < 0.0f)
             readTimeInSamples += float(sizeInSamples);
         float outSample = linearInterpolation (readTimeInSamples, channelIdx); // interpolation between two neighbours
-        buffer[channelIdx][writeIndex] = _inSample + feedback * outSample;     // update buffer
+        float writeSample = _inSample + feedback * outSample;                  // sample written to the buffer
+        buffer[channelIdx][writeIndex] = writeSample;                          // update buffer
+        if (std::abs (writeSample) >= silenceThreshold)
+            samplesSinceLoudWrite = 0;
         return (1.0f - dryWet) * _inSample + dryWet * outSample;               // output effect with specified dry/wet
     }
 
@@ -146,6 +244,32 @@ private:
         return (1.0f - weight) * buffer[channelIdx][indexA] + weight * buffer[channelIdx][indexB];
     }
 
+    /// process mono or stereo audio buffer
+    /// @param juce::AudioBuffer&, input audio buffer with samples
+    /// @param int, number of samples in the buffer
+    void processChannels (juce::AudioSampleBuffer& outputBuffer, int numSamples)
+    {
+        int numChannels = outputBuffer.getNumChannels();
+        if (numChannels == 1)
+            processMono (outputBuffer.getWritePointer (0), numSamples);
+        else if (numChannels == 2)
+            processStereo (outputBuffer.getWritePointer (0), outputBuffer.getWritePointer (1), numSamples);
+    }
+
+#if PMSYNTH_SIMD_DISPATCH
+    /// AVX2 kernel of processChannels()
+    PMSYNTH_SIMD_AVX2 void processChannelsAvx2 (juce::AudioSampleBuffer& outputBuffer, int numSamples)
+    {
+        processChannels (outputBuffer, numSamples);
+    }
+
+    /// AVX-512 kernel of processChannels()
+    PMSYNTH_SIMD_AVX512 void processChannelsAvx512 (juce::AudioSampleBuffer& outputBuffer, int numSamples)
+    {
+        processChannels (outputBuffer, numSamples);
+    }
+#endif
+
     /// process mono audio buffer
     /// @param float*, array with input samples
     /// @param int, number of samples
@@ -201,6 +325,7 @@ private:
         dryWet = smoothedDryWet.getNextValue();
         // increment buffers write position
         writeIndex = (writeIndex + 1) % sizeInSamples;
+        samplesSinceLoudWrite = juce::jmin (samplesSinceLoudWrite + 1, sizeInSamples);
     }
 };
 
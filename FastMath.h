@@ -0,0 +1,133 @@
+#ifndef FAST_MATH_H
+#define FAST_MATH_H
+
+#include <cstdint> // for int32_t
+#include <cstring> // for std::memcpy
+#include <cmath>   // for fabsf() and std::copysign()
+
+/// Switch for using fast approximations on the synth's audio paths
+/// (the oscillators sine, filter coefficients, detune and pitch envelope ratios).
+/// Add PMSYNTH_FAST_MATH=0 to preprocessor definitions to use the standard library and JUCE functions.
+#ifndef PMSYNTH_FAST_MATH
+ #define PMSYNTH_FAST_MATH 1
+#endif
+
+/// Fast approximations of transcendental functions.
+/// Functions are polynomials without branches: range reduction uses only float-integer
+/// conversions, sign copies and min/max selects, which have SIMD instructions, so the
+/// block versions (and any loop over the scalar versions) are vectorized by the compiler.
+/// Maximum errors were measured in float over the whole valid input range.
+namespace FastMath
+{
+    constexpr float pi = 3.14159265358979f; // pi
+
+    /// round to the nearest integer (halves are rounded away from zero)
+    /// @param float, value (|value| < 2^31)
+    /// @return float, rounded value
+    inline float round (float _x)
+    {
+        return float (int32_t (_x + std::copysign (0.5f, _x)));
+    }
+
+    /// sine approximation on [-pi/2, pi/2] (odd minimax polynomial of the 7th order for the relative error)
+    /// @param float, angle in radians in range [-pi/2, pi/2]
+    /// @return float, sine value (relative error below 1e-6)
+    inline float sinPolynomial (float _x)
+    {
+        float x2 = _x * _x;
+        return _x * (0.999999061f + x2 * (-0.166655541f + x2 * (0.00831190018f + x2 * -0.000184881514f)));
+    }
+
+    /// sine of a phase given in cycles
+    /// @param float, phase in cycles (one cycle equals 2 pi, |phase| < 2^31)
+    /// @return float, sine value (absolute error below 1.1e-6)
+    inline float sinCycles (float _phase)
+    {
+        // wrap the phase into [-1/2, 1/2]
+        float p = _phase - round (_phase);
+        // fold the phase magnitude into [0, 1/4] using sin(pi - x) = sin(x), the sine is odd
+        float a = fabsf (p);
+        float b = 0.5f - a;
+        a = a < b ? a : b;
+        return std::copysign (sinPolynomial (2.0f * pi * a), p);
+    }
+
+    /// cheap sine of a phase given in cycles for the draft quality (a parabola refined by
+    /// a second parabola without folding the phase, about half the work of sinCycles())
+    /// @param float, phase in cycles (one cycle equals 2 pi, |phase| < 2^31)
+    /// @return float, sine value (absolute error below 9.3e-4)
+    inline float sinCyclesDraft (float _phase)
+    {
+        // wrap the phase into [-1/2, 1/2]
+        float p = _phase - round (_phase);
+        float y = 8.0f * p - 16.0f * p * fabsf (p);
+        return y + 0.224f * (y * fabsf (y) - y);
+    }
+
+    /// sine approximation
+    /// @param float, angle in radians (|angle| < 1e5)
+    /// @return float, sine value (absolute error below 1.1e-6 plus the error of the angle
+    ///         rounding, which is 2^-24 of the angle)
+    inline float sin (float _x)
+    {
+        return sinCycles (_x * (0.5f / pi));
+    }
+
+    /// tangent approximation calculated as a ratio of sine and cosine polynomials
+    /// @param float, angle in radians in range (-pi/2, pi/2)
+    /// @return float, tangent value (relative error below 2.5e-6 for |angle| < 1.5)
+    inline float tan (float _x)
+    {
+        return sinPolynomial (_x) / sinPolynomial (0.5f * pi - fabsf (_x));
+    }
+
+    /// power of two approximation (polynomial of the 5th order for the fractional part
+    /// with the integer part added to the float exponent)
+    /// @param float, exponent in range [-126, 127]
+    /// @return float, power of two (relative error below 2.5e-7)
+    inline float exp2 (float _x)
+    {
+        // split the exponent into integer and fractional (from -1/2 to 1/2) parts
+        float xi = round (_x);
+        float f = _x - xi;
+        float y = 1.00000007f + f * (0.693146967f + f * (0.240221197f + f * (0.0555071331f + f * (0.00967554152f + f * 0.00132764602f))));
+        // add the integer part to the exponent bits
+        int32_t bits;
+        std::memcpy (&bits, &y, sizeof (bits));
+        bits += int32_t (xi) * (1 << 23);
+        std::memcpy (&y, &bits, sizeof (y));
+        return y;
+    }
+
+    /// sine approximation for a block of values
+    /// @param const float*, angles in radians
+    /// @param float*, output values (can be the same as input)
+    /// @param int, number of values
+    inline void sin (const float* _in, float* _out, int _numValues)
+    {
+        for (int i = 0; i < _numValues; i++)
+            _out[i] = sin (_in[i]);
+    }
+
+    /// tangent approximation for a block of values
+    /// @param const float*, angles in radians
+    /// @param float*, output values (can be the same as input)
+    /// @param int, number of values
+    inline void tan (const float* _in, float* _out, int _numValues)
+    {
+        for (int i = 0; i < _numValues; i++)
+            _out[i] = tan (_in[i]);
+    }
+
+    /// power of two approximation for a block of values
+    /// @param const float*, exponents
+    /// @param float*, output values (can be the same as input)
+    /// @param int, number of values
+    inline void exp2 (const float* _in, float* _out, int _numValues)
+    {
+        for (int i = 0; i < _numValues; i++)
+            _out[i] = exp2 (_in[i]);
+    }
+}
+
+#endif // FAST_MATH_H
@@ -1,8 +1,10 @@
 #ifndef FILTER_MOD_H
 #define FILTER_MOD_H
 
-#include <JuceHeader.h> // for defining juce classes variables
-#include "Parameters.h" // for accessing parameters set by the user interface
+#include <JuceHeader.h>    // for defining juce classes variables
+#include "Parameters.h"    // for accessing parameters set by the user interface
+#include "FastMath.h"      // for the tangent approximation
+#include "VoiceTemplate.h" // for filter values derived from parameters
 
 /// Filter class.
 /// Filter type can be set by using setType() class method.
@@ -22,31 +24,40 @@ public:
 
     /// process input sample
     /// @param float, input sample
+    /// @param int, sample index in the current modulation block
     /// @return float, filter output
-    float process (float _inSample)
+    float process (float _inSample, int _sampleIdx)
     {
-        jassert (sampleRate > 0.0f); // check if sample rate is set (the default value on initialization is 0)
-        float envVal = env.getNextSample();
-        // calculate frequency with modulations
-        float freq = frequency + envAmount * envVal * frequencyMaxOffset + frequencyOffset;
-        // check bounds
-        if (freq > maxFrequency)
-            freq = maxFrequency;
-        if (freq < minFrequency)
-            freq = minFrequency;
-        // calculate resonance with modulations
-        float res = resonance + resonanceOffset;
-        // check resonance bounds
-        if (res < minResonance)
-            res = minResonance;
-        if (res > maxResonance)
-            res = maxResonance;
-        filter.setCoefficients (makeFilterCoefficients (sampleRate, freq, res));
-        // reset modulations
-        resetModulations();
+        if (updateCoefficients (_sampleIdx))
+            filter.setCoefficients (coefficients);
         return filter.processSingleSampleRaw (_inSample);
     }
 
+    /// process a stereo pair of input samples (both channels share the cutoff envelope and modulations)
+    /// @param float&, left input sample (is overwritten with filter output)
+    /// @param float&, right input sample (is overwritten with filter output)
+    /// @param int, sample index in the current modulation block
+    void processStereo (float& _left, float& _right, int _sampleIdx)
+    {
+        if (updateCoefficients (_sampleIdx))
+        {
+            filter.setCoefficients (coefficients);
+            filterRight.setCoefficients (coefficients);
+        }
+        _left = filter.processSingleSampleRaw (_left);
+        _right = filterRight.processSingleSampleRaw (_right);
+    }
+
+    /// set render quality (coefficients are updated at control rate in draft quality
+    /// and are calculated in double precision in offline quality)
+    /// @param int, quality tier (see Parameters.h)
+    void setQuality (int _quality)
+    {
+        quality = _quality;
+        coefficientsInterval = _quality == Parameters::draftQuality ? Parameters::draftControlInterval : 1;
+        samplesToUpdate = 0;
+    }
+
     /// set sample rate
     /// @param float, sample rate
     void setSampleRate (float _sampleRate)
@@ -73,6 +84,7 @@ public:
     /// @param int, filter type (0 - low pass, 1 - high pass, 2 - band pass, 3 - notch
     void setType (int _filterType)
     {
+        filterType = _filterType;
         switch (_filterType)
         {
         case 0:
@@ -108,20 +120,22 @@ public:
         envAmount = _envAmount;
     }
 
-    /// start the attack phase of the filter cutoff envelope and update filter's parameters
-    /// @param Parameters*, pointer to parameters set by the user interface
+    /// start the attack phase of the filter cutoff envelope and copy filter's values from the voice template
+    /// @param const VoiceTemplate::Filter&, filter values
     /// @param float, sample rate [Hz]
-    void startNote (Parameters* param, float _sampleRate)
+    void startNote (const VoiceTemplate::Filter& _filter, float _sampleRate)
     {
         filter.reset();
+        filterRight.reset();
         env.reset();
+        samplesToUpdate = 0;
 
         (*this).setSampleRate (_sampleRate);
-        (*this).setType (*param->filterTypeParam);
-        (*this).setFrequency (*param->filterFrequencyParam);
-        (*this).setResonance (*param->filterResonanceParam);
-        (*this).setEnvParameters (*param->filterAttackParam, *param->filterDecayParam, *param->filterSustainParam, *param->filterReleaseParam);
-        (*this).setEnvAmount (*param->filterEnvAmountParam);
+        (*this).setType (_filter.type);
+        (*this).setFrequency (_filter.frequency);
+        (*this).setResonance (_filter.resonance);
+        env.setParameters (_filter.env);
+        (*this).setEnvAmount (_filter.envAmount);
 
         env.noteOn();
     }
@@ -132,32 +146,41 @@ public:
         env.noteOff();
     }
 
-    /// set frequency offset (used for external modulations)
-    /// @param float, frequency offset amount (from -1 to 1)
-    void setFrequencyOffset (float _frequencyOffsetAmount)
+    /// get an upper bound of the filter gain (peak gain of resonant filters is close to their Q)
+    /// @param bool, flag for resonance modulated in the current modulation block
+    /// @return float, maximum gain
+    float getMaxGain (bool _isResonanceModulated) const
     {
-        frequencyOffset += _frequencyOffsetAmount * frequencyMaxOffset;
+        return juce::jmax (1.0f, 1.2f * (_isResonanceModulated ? maxResonance : resonance));
     }
 
-    /// set resonance offset (used for external modulations)
-    /// @param float, resonance offset amount (from -1 to 1)
-    void setResonanceOffset (float _resonanceOffsetAmount)
+    /// set modulation buffers for the current modulation block
+    /// @param const float*, frequency modulation buffer (amounts from -1 to 1)
+    /// @param const float*, resonance modulation buffer (amounts from -1 to 1)
+    void setModulationBuffers (const float* _frequencyModulation, const float* _resonanceModulation)
     {
-        resonanceOffset += _resonanceOffsetAmount * resonanceMaxOffset;
+        frequencyModulation = _frequencyModulation;
+        resonanceModulation = _resonanceModulation;
     }
 private:
     float sampleRate = 0.0f;                                                                         // sample rate [Hz]
     // base members
     juce::IIRFilter filter;                                                                          // filter instance
+    juce::IIRFilter filterRight;                                                                     // filter instance for the right channel in stereo processing
     juce::IIRCoefficients (*makeFilterCoefficients) (double sampleRate, double frequency, double Q); // pointer to a function with calculates filter coefficiens using specified sample rate, cutoff frequency and resonance
+    int filterType = 0;                                                                              // filter type (0 - low pass, 1 - high pass, 2 - band pass, 3 - notch)
+    juce::IIRCoefficients coefficients;                                                              // current filter coefficients
+    int quality = Parameters::realtimeQuality;                                                       // render quality tier
+    int coefficientsInterval = 1;                                                                    // samples between coefficients updates
+    int samplesToUpdate = 0;                                                                         // samples until the next coefficients update
     juce::ADSR env;                                                                                  // filter cutoff envelope
     // filter parameters
     float frequency;
     float resonance;
     float envAmount = 0.0f;
-    // modulation parameters
-    float frequencyOffset = 0.0f;
-    float resonanceOffset = 0.0f;
+    // modulation buffers
+    const float* frequencyModulation = nullptr;
+    const float* resonanceModulation = nullptr;
     // parameters bounds
     const float minFrequency;
     const float maxFrequency;
@@ -166,6 +189,68 @@ private:
     float frequencyMaxOffset;
     float resonanceMaxOffset;
 
+    /// update the cutoff envelope and calculate filter coefficients for the next sample when they are due
+    /// @param int, sample index in the current modulation block
+    /// @return bool, true if coefficients were updated
+    bool updateCoefficients (int _sampleIdx)
+    {
+        jassert (sampleRate > 0.0f); // check if sample rate is set (the default value on initialization is 0)
+        float envVal = env.getNextSample();
+        if (--samplesToUpdate > 0)
+            return false;
+        samplesToUpdate = coefficientsInterval;
+        // calculate frequency with modulations
+        float freq = frequency + (envAmount * envVal + frequencyModulation[_sampleIdx]) * frequencyMaxOffset;
+        // check bounds
+        if (freq > maxFrequency)
+            freq = maxFrequency;
+        if (freq < minFrequency)
+            freq = minFrequency;
+        // calculate resonance with modulations
+        float res = resonance + resonanceModulation[_sampleIdx] * resonanceMaxOffset;
+        // check resonance bounds
+        if (res < minResonance)
+            res = minResonance;
+        if (res > maxResonance)
+            res = maxResonance;
+#if PMSYNTH_FAST_MATH
+        if (quality != Parameters::offlineQuality)
+        {
+            coefficients = makeFastCoefficients (freq, res);
+            return true;
+        }
+#endif
+        coefficients = makeFilterCoefficients (sampleRate, freq, res);
+        return true;
+    }
+
+    /// calculate filter coefficients in float with the tangent approximation
+    /// (the same formulas as in juce::IIRCoefficients functions set by setType())
+    /// @param float, cutoff frequency [Hz]
+    /// @param float, resonance
+    /// @return juce::IIRCoefficients, filter coefficients
+    juce::IIRCoefficients makeFastCoefficients (float _frequency, float _resonance) const
+    {
+        float t = FastMath::tan (FastMath::pi * _frequency / sampleRate);
+        float n = filterType == 1 ? t : 1.0f / t;
+        float nSquared = n * n;
+        float nQ = n / _resonance;
+        float c1 = 1.0f / (1.0f + nQ + nSquared);
+        float a2 = c1 * 2.0f * (1.0f - nSquared);
+        float a3 = c1 * (1.0f - nQ + nSquared);
+        switch (filterType)
+        {
+        case 1:
+            return juce::IIRCoefficients (c1, -2.0f * c1, c1, 1.0f, -a2, a3);
+        case 2:
+            return juce::IIRCoefficients (c1 * nQ, 0.0f, -c1 * nQ, 1.0f, a2, a3);
+        case 3:
+            return juce::IIRCoefficients (c1 * (1.0f + nSquared), a2, c1 * (1.0f + nSquared), 1.0f, a2, a3);
+        default:
+            return juce::IIRCoefficients (c1, 2.0f * c1, c1, 1.0f, a2, a3);
+        }
+    }
+
     /// set filter coefficients function
     /// @param juce::IIRCoefficients (*_func) (double, double, double), pointer to a function,
     ///        which calculates filter coefficients by using sample rate, cutoff and resonance values
@@ -173,13 +258,6 @@ private:
     {
         makeFilterCoefficients = _func;
     }
-
-    /// reset external filter modulations (frequency and resonance modulations)
-    void resetModulations()
-    {
-        frequencyOffset = 0.0f;
-        resonanceOffset = 0.0f;
-    }
 };
 
 #endif // FILTER_MOD_H
\ No newline at end of file
@@ -1,16 +1,16 @@
 #ifndef LFO_H
 #define LFO_H
 
-#include <JuceHeader.h> // for juce::NormalisableRange and juce::SmoothedValue
-#include "OscSwitch.h"  // base oscillator class
-#include "Parameters.h" // for accessing parameters set by the user interface
+#include <JuceHeader.h>    // for juce::NormalisableRange and juce::SmoothedValue
+#include "OscSwitch.h"     // base oscillator class
+#include "Parameters.h"    // for accessing parameters set by the user interface
+#include "VoiceTemplate.h" // for LFO values derived from parameters
 
 /// LFO class wrapped around OscSwitch oscillator class.
-/// LFO class stores information about possible routings
-/// in the user interface. Class contains a set of methods 
-/// for checking if an LFO instance is applied to a particular 
-/// variable. LFO class needs to be revisited if there were
-/// changes to the routing parameters in the user interface.
+/// LFO renders its output into a block buffer which is routed
+/// to modulation destinations by the modulation matrix (see ModMatrix.h).
+/// LFO rate and amount can be modulated by other LFOs through
+/// modulation buffers passed to the process() method.
 class LFO
 {
 public:
@@ -22,30 +22,45 @@ public:
         frequencyMaxOffset = 0.5 * (maxFrequency - minFrequency); // max frequency offset for an external LFO
     }
 
-    /// process LFO
-    /// @param float, output sample
-    float process()
+    /// process LFO block
+    /// @param float*, output buffer
+    /// @param const float*, frequency modulation buffer (amounts from -1 to 1) or nullptr if LFO rate isn't modulated
+    /// @param const float*, amount modulation buffer
+    /// @param int, number of samples
+    void process (float* outBuffer, const float* frequencyModulation, const float* amountModulation, int numSamples)
     {
-        // LFO amount
-        float am = amount + amountOffset;
-        if (am > 1.0f)
-            am = 1.0f;
-        if (am < -1.0f)
-            am = -1.0f;
-        // LFO frequency
-        float freq = frequency + frequencyOffset;
-        if (freq > maxFrequency)
-            freq = maxFrequency;
-        if (freq < minFrequency)
-            freq = minFrequency;
-        // calculate smoothed value
-        lfo.setFrequency (freq);
-        float lfoSample = am * lfo.process();
-        smoothedLFOValue.setTargetValue (lfoSample);
-        float smoothedLFOSample = smoothedLFOValue.getNextValue();
+        // unmodulated frequency doesn't need per-sample bounds check
+        if (frequencyModulation == nullptr)
+            lfo.setFrequency (frequency * float (controlInterval));
+        for (int j = 0; j < numSamples; j++)
+        {
+            // LFO is updated every sample (or at control rate in draft quality)
+            if (--samplesToUpdate <= 0)
+            {
+                samplesToUpdate = controlInterval;
+                // LFO amount
+                float am = amount + amountModulation[j];
+                if (am > 1.0f)
+                    am = 1.0f;
+                if (am < -1.0f)
+                    am = -1.0f;
+                // LFO frequency (the phase advances for all samples until the next update)
+                if (frequencyModulation != nullptr)
+                {
+                    float freq = frequency + frequencyModulation[j] * frequencyMaxOffset;
+                    if (freq > maxFrequency)
+                        freq = maxFrequency;
+                    if (freq < minFrequency)
+                        freq = minFrequency;
+                    lfo.setFrequency (freq * float (controlInterval));
+                }
+                lfoSample = am * lfo.process();
+            }
+            // calculate smoothed value
+            smoothedLFOValue.setTargetValue (lfoSample);
+            outBuffer[j] = smoothedLFOValue.getNextValue();
+        }
         phase = lfo.getPhase();
-        resetModulations();
-        return smoothedLFOSample;
     }
 
     /// set sample rate for LFO
@@ -67,14 +82,15 @@ public:
     void setFrequency (float _frequency)
     {
         frequency = _frequency;
-        lfo.setFrequency (_frequency);
+        lfo.setFrequency (_frequency * float (controlInterval));
     }
 
-    /// set LFO frequency offset (useful for frequency modulation)
-    /// @param float, frequency offset amount (from -1 to 1)
-    void setFrequencyOffset (float _frequencyOffsetAmount)
+    /// set render quality (LFO is updated at control rate in draft quality)
+    /// @param int, quality tier (see Parameters.h)
+    void setQuality (int _quality)
     {
-        frequencyOffset += _frequencyOffsetAmount * frequencyMaxOffset;
+        controlInterval = _quality == Parameters::draftQuality ? Parameters::draftControlInterval : 1;
+        samplesToUpdate = 0;
     }
 
     /// set LFO amplitude
@@ -91,106 +107,33 @@ public:
         amount = _amount;
     }
 
-    /// set LFO amount offset (useful for external modulations)
-    /// @param float, offset for LFO amount
-    void setAmountOffset (float _amountOffset)
-    {
-        amountOffset += _amountOffset;
-    }
-
-    /// update LFO parameters
-    /// @param Parameters*, pointer to parameters set by the user interface
-    /// @param int, LFO index
+    /// copy LFO values from the voice template and restart the LFO
+    /// @param const VoiceTemplate::LFO&, LFO values
     /// @param float, samples rate [Hz]
-    void startNote (Parameters* _param, int _idx, float _sampleRate)
+    void startNote (const VoiceTemplate::LFO& _lfo, float _sampleRate)
     {
-        (*this).setWaveshape (*_param->lfoWaveshapeParam[_idx]);
+        // waveshape is set first, so the sample rate goes to the oscillator which is used
+        (*this).setWaveshape (_lfo.waveshape);
         (*this).setSampleRate (_sampleRate);
-        (*this).setFrequency (*_param->lfoRateParam[_idx]);
-        (*this).setAmount (*_param->lfoAmountParam[_idx]);
-        if (*_param->lfoRetriggerParam[_idx] == true)
+        setParameters (_lfo);
+        if (isRetriggered)
         {
             phase = 0.0f;
             lfo.setPhase (0.0f);
         }
         smoothedLFOValue.reset (_sampleRate, 1e-2f);
         smoothedLFOValue.setCurrentAndTargetValue (0.0f);
+        samplesToUpdate = 0;
     }
 
-    /// check if LFO is applied to the operator level
-    /// @param int, LFO destination
-    /// @param int, number of operators in the synth
-    /// @return bool, true if LFO is applied
-    bool isAppliedToOpLevel (int lfoDestination, int numOperators)
-    {
-        if (lfoDestination < numOperators)
-            return true;
-        else
-            return false;
-    }
-
-    /// check if LFO is applied to operators phases
-    /// @param int, LFO destination
-    /// @param int, number of operators in the synth
-    /// @return bool, true if LFO is applied
-    bool isAppliedToOpsPhase (int lfoDestination, int numOperators)
-    {
-        if (lfoDestination == numOperators)
-            return true;
-        else
-            return false;
-    }
-
-    /// check if LFO is applied to filter cutoff frequency
-    /// @param int, LFO destination
-    /// @param int, number of operators in the synth
-    /// @return bool, true if LFO is applied
-    bool isAppliedToFilterFreq (int lfoDestination, int numOperators)
+    /// copy LFO values from the voice template (the sample rate must be set)
+    /// @param const VoiceTemplate::LFO&, LFO values
+    void setParameters (const VoiceTemplate::LFO& _lfo)
     {
-        if (lfoDestination == numOperators + 1)
-            return true;
-        else
-            return false;
-    }
-
-    /// check if LFO is applied to filter resonance
-    /// @param int, LFO destination
-    /// @param int, number of operators in the synth
-    /// @return bool, true if LFO is applied
-    bool isAppliedToFilterRes (int lfoDestination, int numOperators)
-    {
-        if (lfoDestination == numOperators + 2)
-            return true;
-        else
-            return false;
-    }
-
-    /// check if LFO is applied to another LFO's rate
-    /// @param int, LFO destination
-    /// @param int, number of operators in the synth
-    /// @param int, number of LFOs in the synth
-    /// @return bool, true if LFO is applied
-    bool isAppliedToLFORate (int lfoDestination, int numOperators, int numLFOs)
-    {
-        int idxStart = numOperators + 3;
-        if (lfoDestination >= idxStart && lfoDestination < idxStart + 2 * (numLFOs-1) && (lfoDestination - idxStart) % 2 == 0)
-            return true;
-        else
-            return false;
-    }
-
-    /// check if LFO is applied to another LFO's amount
-    /// @param int, LFO destination
-    /// @param int, number of operators in the synth
-    /// @param int, number of LFOs in the synth
-    /// @return bool, true if LFO is applied
-    bool isAppliedToLFOAmount (int lfoDestination, int numOperators, int numLFOs)
-    {
-        int idxStart = numOperators + 3;
-        if (lfoDestination >= idxStart && lfoDestination < idxStart + 2 * (numLFOs - 1) && (lfoDestination - idxStart) % 2 == 1)
-            return true;
-        else
-            return false;
+        (*this).setWaveshape (_lfo.waveshape);
+        isRetriggered = _lfo.isRetriggered;
+        (*this).setFrequency (_lfo.frequency);
+        (*this).setAmount (_lfo.amount);
     }
 
 private:
@@ -201,20 +144,16 @@ private:
     float amount;
     float frequency;
     float phase = 0.0f; // is stored so there is an option to not retrigger LFO with a new note
+    bool isRetriggered = true; // retrigger switch
+    // control rate
+    int controlInterval = 1;   // samples between LFO updates
+    int samplesToUpdate = 0;   // samples until the next LFO update
+    float lfoSample = 0.0f;    // LFO output at the last update
     // modulation parameters
-    float amountOffset = 0.0f;
-    float frequencyOffset = 0.0f;
     float frequencyMaxOffset;
     // bounds
     float minFrequency;
     float maxFrequency;
-
-    /// reset external LFO modulations (frequency and amount modulations)
-    void resetModulations()
-    {
-        frequencyOffset = 0.0f;
-        amountOffset = 0.0f;
-    }
 };
 
 #endif // LFO_H
\ No newline at end of file
@@ -0,0 +1,151 @@
+#ifndef LAZY_RESOURCE_H
+#define LAZY_RESOURCE_H
+
+#include <JuceHeader.h>      // for juce::TimeSliceThread and juce::SharedResourcePointer
+#include <atomic>            // for std::atomic
+#include <functional>        // for std::function
+#include <memory>            // for unique_ptr
+#include "RealtimeChecker.h" // for allowing synchronous allocation
+
+/// Background thread which allocates and releases lazy resources.
+/// A single thread is shared between all plugin instances in the process
+/// (it is accessed through juce::SharedResourcePointer).
+class ResourceThread : public juce::TimeSliceThread
+{
+public:
+    /// constructor which starts the thread
+    ResourceThread() :
+        juce::TimeSliceThread ("PMSynth resources")
+    {
+        startThread();
+    }
+
+    /// destructor which stops the thread
+    ~ResourceThread() override
+    {
+        stopThread (1000);
+    }
+};
+
+/// Lazy resource class.
+/// A resource (e.g. effect memory) is allocated on the background thread when
+/// the audio thread first asks for it, and is published to the audio thread with
+/// an atomic pointer. If the audio thread doesn't ask for the resource for a while,
+/// it is released on the background thread. The audio thread never allocates, frees
+/// or waits: while the resource isn't ready acquire() returns nullptr. For non-realtime
+/// rendering the resource can be allocated synchronously, so no output is rendered
+/// without it.
+template <typename Resource>
+class LazyResource : private juce::TimeSliceClient
+{
+public:
+    using Factory = std::function<std::unique_ptr<Resource>()>; // function which creates a resource
+
+    /// constructor which registers the resource with the background thread
+    /// @param int, time without requests after which the resource is released [ms]
+    LazyResource (int _releaseTimeMs) :
+        releaseTimeMs (_releaseTimeMs)
+    {
+        thread->addTimeSliceClient (this);
+    }
+
+    /// destructor which unregisters the resource and frees it
+    ~LazyResource() override
+    {
+        thread->removeTimeSliceClient (this);
+        delete published.load();
+    }
+
+    /// set a function which creates the resource and free the current one
+    /// (call only when the audio thread isn't processing, e.g. in prepareToPlay())
+    /// @param Factory, function which creates a resource
+    void prepare (Factory _factory)
+    {
+        const juce::ScopedLock lock (factoryLock);
+        factory = std::move (_factory);
+        delete published.exchange (nullptr);
+    }
+
+    /// free the resource (call only when the audio thread isn't processing, e.g. in releaseResources())
+    void releaseNow()
+    {
+        const juce::ScopedLock lock (factoryLock);
+        delete published.exchange (nullptr);
+        isRequested.store (false);
+    }
+
+    /// allow allocating the resource on the thread which asks for it (e.g. for non-realtime rendering)
+    /// @param bool, flag for synchronous allocation
+    void setSynchronous (bool _isSynchronous)
+    {
+        isSynchronous.store (_isSynchronous);
+    }
+
+    /// request the resource and start using it (audio thread);
+    /// finishUse() should be called when the resource isn't used anymore in the current block
+    /// @return Resource*, resource or nullptr if it isn't allocated yet
+    Resource* acquire()
+    {
+        isRequested.store (true);
+        isInUse.store (true);
+        if (isSynchronous.load() && published.load() == nullptr)
+        {
+            RealtimeChecker::ScopedAllow allowBlocking;
+            const juce::ScopedLock lock (factoryLock);
+            if (published.load() == nullptr && factory)
+                published.store (factory().release());
+        }
+        return published.load();
+    }
+
+    /// finish using the resource in the current block (audio thread)
+    void finishUse()
+    {
+        isInUse.store (false);
+    }
+
+private:
+    juce::SharedResourcePointer<ResourceThread> thread; // shared background thread
+    juce::CriticalSection factoryLock;                  // lock for factory changes and allocation (the audio thread takes it only for synchronous allocation)
+    Factory factory;                                    // function which creates a resource
+    std::atomic<Resource*> published { nullptr };       // resource published to the audio thread
+    std::atomic<bool> isRequested { false };            // flag set by the audio thread when it asks for the resource
+    std::atomic<bool> isInUse { false };                // flag for the resource being used by the audio thread
+    std::atomic<bool> isSynchronous { false };          // flag for allocation on the thread which asks for the resource
+    const int releaseTimeMs;                            // time without requests after which the resource is released [ms]
+    juce::uint32 lastRequestTime = 0;                   // time of the last seen request [ms] (background thread only)
+
+    /// allocate requested resource or release unused one (background thread)
+    /// @return int, time until the next call [ms]
+    int useTimeSlice() override
+    {
+        Resource* retired = nullptr;
+        {
+            const juce::ScopedLock lock (factoryLock);
+            juce::uint32 now = juce::Time::getMillisecondCounter();
+            Resource* current = published.load();
+            if (isRequested.exchange (false))
+            {
+                lastRequestTime = now;
+                if (current == nullptr && factory)
+                    published.store (factory().release());
+            }
+            else if (current != nullptr && now - lastRequestTime > juce::uint32 (releaseTimeMs))
+            {
+                published.store (nullptr);
+                retired = current;
+            }
+        }
+        // wait for the audio thread to finish the block where the unpublished resource could have been used;
+        // the lock is released first, since a synchronous acquire() takes it while the resource is in use
+        if (retired != nullptr)
+        {
+            while (isInUse.load())
+                juce::Thread::sleep (1);
+            delete retired;
+        }
+        return published.load() == nullptr ? 10 : 100;
+    }
+};
+
+#endif // LAZY_RESOURCE_H
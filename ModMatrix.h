@@ -0,0 +1,171 @@
+#ifndef MOD_MATRIX_H
+#define MOD_MATRIX_H
+
+#include <JuceHeader.h> // for juce::FloatVectorOperations
+#include <vector>       // for std::vector
+#include <algorithm>    // for std::fill
+#include "Parameters.h" // for accessing parameters set by the user interface
+
+/// Modulation matrix class.
+/// Modulation sources (LFOs) render into per-block source buffers and
+/// modulation destinations read per-block destination buffers directly.
+/// Routes set by the user interface are resolved once per block into a
+/// flat table of (source buffer, destination buffer, depth). Destinations
+/// without any routes read a shared buffer of zeros, so there is no
+/// per-sample routing logic. Destination indices follow the order of
+/// LFO destinations in the parameter layout: operators levels, operators
+/// phase, filter frequency, filter resonance and then rate and amount
+/// for each LFO.
+class ModMatrix
+{
+public:
+    static constexpr int blockSize = 64; // maximum number of samples in a modulation block
+
+    /// constructor which allocates modulation buffers
+    /// @param int, number of operators in the synth
+    /// @param int, number of LFOs in the synth
+    ModMatrix (int _numOperators, int _numLFOs) :
+        numOperators (_numOperators), numLFOs (_numLFOs), numDestinations (_numOperators + 3 + 2 * _numLFOs),
+        sourceBuffers (size_t (_numLFOs * blockSize), 0.0f),
+        destinationBuffers (size_t ((_numOperators + 3 + 2 * _numLFOs) * blockSize), 0.0f),
+        zeros (size_t (blockSize), 0.0f),
+        isRouted (size_t (_numOperators + 3 + 2 * _numLFOs), false),
+        routes (size_t (_numLFOs))
+    {
+    }
+
+    /// resolve routes set by the user interface and clear routed destination buffers
+    /// @param Parameters*, pointer to parameters set by the user interface
+    /// @param int, number of samples in the block
+    void beginBlock (Parameters* _param, int _numSamples)
+    {
+        jassert (_numSamples <= blockSize);
+        std::fill (isRouted.begin(), isRouted.end(), false);
+        numRoutes = 0;
+        for (int i = 0; i < numLFOs; i++)
+        {
+            // check on/off switch
+            if (*_param->lfoOnParam[i] == false)
+                continue;
+            int destination = int (*_param->lfoDestinationParam[i]);
+            jassert (destination >= 0 && destination < numDestinations);
+            if (isRouted[destination] == false)
+                juce::FloatVectorOperations::clear (getDestinationBuffer (destination), _numSamples);
+            isRouted[destination] = true;
+            routes[numRoutes++] = { i, getDestinationBuffer (destination), 1.0f };
+        }
+    }
+
+    /// add a rendered source block to all of its destinations
+    /// @param int, source index
+    /// @param int, number of samples in the block
+    void applyRoutes (int _sourceIdx, int _numSamples)
+    {
+        applyRoutes (_sourceIdx, getSourceBuffer (_sourceIdx), _numSamples);
+    }
+
+    /// add a source block rendered outside the matrix (e.g. by a shared LFO) to all destinations of the source
+    /// @param int, source index
+    /// @param const float*, source block
+    /// @param int, number of samples in the block
+    void applyRoutes (int _sourceIdx, const float* _source, int _numSamples)
+    {
+        for (int i = 0; i < numRoutes; i++)
+        {
+            if (routes[i].sourceIdx == _sourceIdx)
+                juce::FloatVectorOperations::addWithMultiply (routes[i].destination, _source, routes[i].depth, _numSamples);
+        }
+    }
+
+    /// check if a source has any routes in the current block
+    /// @param int, source index
+    /// @return bool, true if the source is routed
+    bool isSourceRouted (int _sourceIdx) const
+    {
+        for (int i = 0; i < numRoutes; i++)
+        {
+            if (routes[i].sourceIdx == _sourceIdx)
+                return true;
+        }
+        return false;
+    }
+
+    /// get buffer for a modulation source to render into
+    /// @param int, source index (LFO index)
+    /// @return float*, source buffer
+    float* getSourceBuffer (int _sourceIdx)
+    {
+        return sourceBuffers.data() + _sourceIdx * blockSize;
+    }
+
+    /// check if a destination has any routes in the current block
+    /// @param int, destination index
+    /// @return bool, true if the destination is routed
+    bool isDestinationRouted (int _destinationIdx) const
+    {
+        return isRouted[_destinationIdx];
+    }
+
+    /// get modulation values for a destination in the current block
+    /// @param int, destination index
+    /// @return const float*, destination buffer (zeros if the destination isn't routed)
+    const float* getDestination (int _destinationIdx) const
+    {
+        if (isRouted[_destinationIdx] == false)
+            return zeros.data();
+        return destinationBuffers.data() + _destinationIdx * blockSize;
+    }
+
+    /// @param int, operator index
+    /// @return int, destination index for operator level
+    int getOpLevelDestination (int _opIdx) const { return _opIdx; }
+
+    /// @return int, destination index for operators phase
+    int getOpsPhaseDestination() const { return numOperators; }
+
+    /// @return int, destination index for filter cutoff frequency
+    int getFilterFrequencyDestination() const { return numOperators + 1; }
+
+    /// @return int, destination index for filter resonance
+    int getFilterResonanceDestination() const { return numOperators + 2; }
+
+    /// @param int, LFO index
+    /// @return int, destination index for LFO rate
+    int getLFORateDestination (int _lfoIdx) const { return numOperators + 3 + 2 * _lfoIdx; }
+
+    /// @param int, LFO index
+    /// @return int, destination index for LFO amount
+    int getLFOAmountDestination (int _lfoIdx) const { return numOperators + 4 + 2 * _lfoIdx; }
+
+private:
+    /// modulation route
+    struct Route
+    {
+        int sourceIdx;      // source index
+        float* destination; // destination buffer
+        float depth;        // modulation depth
+    };
+
+    // sizes
+    const int numOperators;                 // number of operators
+    const int numLFOs;                      // number of LFOs (modulation sources)
+    const int numDestinations;              // number of modulation destinations
+    // buffers
+    std::vector<float> sourceBuffers;       // per-block buffers for each source
+    std::vector<float> destinationBuffers;  // per-block buffers for each destination
+    std::vector<float> zeros;               // buffer for destinations without routes
+    std::vector<bool> isRouted;             // flags for destinations with routes in the current block
+    // routes
+    std::vector<Route> routes;              // flat routes table (preallocated for one route per source)
+    int numRoutes = 0;                      // number of routes in the current block
+
+    /// get writable destination buffer
+    /// @param int, destination index
+    /// @return float*, destination buffer
+    float* getDestinationBuffer (int _destinationIdx)
+    {
+        return destinationBuffers.data() + _destinationIdx * blockSize;
+    }
+};
+
+#endif // MOD_MATRIX_H
@@ -1,28 +1,39 @@
 #ifndef OPERATOR_H
 #define OPERATOR_H
 
-#include <JuceHeader.h> // for juce::ADSR
-#include "OscSwitch.h"  // for oscillator with variable waveshape
-#include "Parameters.h" // for accessing parameters set by the user interface
+#include <JuceHeader.h>    // for juce::ADSR
+#include "Oscillators.h"   // for unison oscillator with variable waveshape
+#include "VoiceTemplate.h" // for operator values derived from parameters
 
 /// Operator class.
 /// A class instance consists of an oscillator with
 /// variable waveshape, an amplitude envelope and
-/// a pitch envelope.
+/// a pitch envelope. The oscillator renders a lane
+/// for each unison voice, while envelopes are shared
+/// by all lanes.
 class Operator
 {
 public:
     /// process operator with amplitude and pitch envelopes
-    /// @return float, output sample
-    float process()
+    /// @param int, sample index in the current modulation block
+    /// @param const float*, phase offset from modulating operators for each unison lane
+    /// @param float*, output sample for each unison lane
+    template <int numLanes>
+    void process (int _sampleIdx, const float* _phaseOffset, float* _out)
     {
         float envVal = env.getNextSample();
         float pitchEnvVal = pitchEnv.getNextSample();
-        float freq = frequency * (1.0f + pitchEnvVal * (powf(2.0f, pitchEnvInitialLevel/12.0f) - 1.0f));
-        osc.setFrequency (freq);
-        float oscSample = osc.process();
-        resetModulations();
-        return envVal * oscSample;
+        float freq = frequency * (1.0f + pitchEnvVal * pitchEnvDepth);
+        osc.process<numLanes> (freq, _phaseOffset, phaseModulation[_sampleIdx], amplitudeModulation[_sampleIdx], envVal, _out);
+    }
+
+    /// set modulation buffers for the current modulation block
+    /// @param const float*, amplitude modulation buffer
+    /// @param const float*, phase modulation buffer
+    void setModulationBuffers (const float* _amplitudeModulation, const float* _phaseModulation)
+    {
+        amplitudeModulation = _amplitudeModulation;
+        phaseModulation = _phaseModulation;
     }
 
     /// set sample rate for oscillator
@@ -44,15 +55,13 @@ public:
     void setOscFrequency (float _frequency)
     {
         frequency = _frequency;
-        osc.setFrequency (_frequency);
     }
 
-    /// set phase offset (useful for phase modulation)
-    /// @param float, phase offset
-    void setOscPhaseOffset (float _phaseOffset)
+    /// set render quality
+    /// @param int, quality tier (see Parameters.h)
+    void setQuality (int _quality)
     {
-        phaseOffset += _phaseOffset;
-        osc.setPhaseOffset (phaseOffset);
+        osc.setQuality (_quality);
     }
 
     /// set oscillator amplitude
@@ -62,53 +71,28 @@ public:
         osc.setAmplitude (_amplitude);
     }
 
-    /// set oscillator amplitude offset (useful for amplitude modulation)
-    /// @param float, amplitude
-    void setOscAmplitudeOffset (float _amplitudeOffset)
-    {
-        amplitudeOffset += _amplitudeOffset;
-        osc.setAmplitudeOffset (amplitudeOffset);
-    }
-
-    /// set amplitude envelope parameters
-    /// @param float, attack
-    /// @param float, decay
-    /// @param float, sustain
-    /// @param float, release
-    void setEnvParameters (float _attack, float _decay, float _sustain, float _release)
-    {
-        juce::ADSR::Parameters envParam(_attack, _decay, _sustain, _release);
-        env.setParameters (envParam);
-    }
-
-    /// set pitch envelope parameters
-    /// @param float, initial level (in semitones)
-    /// @param float, decay time
-    void setPitchEnvParameters (float _initialLevel, float _decay)
-    {
-        juce::ADSR::Parameters pitchEnvParam(0.0f, _decay, 0.0f, 0.0f);
-        pitchEnv.setParameters (pitchEnvParam);
-        pitchEnvInitialLevel = _initialLevel;
-    }
-
-    /// start the attack phase of amplitude and picth envelopes and update operator's parameters
-    /// @param Parameters*, pointer to parameters set by the user interface
-    /// @param int, operator index
+    /// start the attack phase of amplitude and picth envelopes and copy operator's values from the voice template
+    /// @param const VoiceTemplate::Operator&, operator values
+    /// @param const VoiceTemplate::PitchEnv&, pitch envelope values
     /// @param float, midi note frequency
     /// @param float, midi note velocity
     /// @param float, sample rate [Hz]
-    void startNote (Parameters* _param, int _idx, float _freq, float _velocity, float _sampleRate)
+    /// @param int, number of unison voices
+    /// @param float, detune of the outer unison voices [cents]
+    void startNote (const VoiceTemplate::Operator& _op, const VoiceTemplate::PitchEnv& _pitchEnv, float _freq, float _velocity, float _sampleRate, int _numUnisonVoices, float _unisonDetune)
     {
         env.reset();
         pitchEnv.reset();
-        (*this).setOscWaveshape (*_param->opWaveshapeParam[_idx]);
+        (*this).setOscWaveshape (_op.waveshape);
+        env.setParameters (_op.env);
+        pitchEnv.setParameters (_pitchEnv.env);
+        pitchEnvDepth = _pitchEnv.depth;
         (*this).setSampleRate (_sampleRate);
-        (*this).setOscFrequency (_freq * (*_param->opCoarseParam[_idx] + *_param->opFineParam[_idx] / 1000.0f));
-        (*this).setOscAmplitude (*_param->opLevelParam[_idx] * _velocity);
-        (*this).setEnvParameters (*_param->opAttackParam[_idx], *_param->opDecayParam[_idx], *_param->opSustainParam[_idx], *_param->opReleaseParam[_idx]);
-        (*this).setPitchEnvParameters (*_param->pitchEnvInitialLevelParam, *_param->pitchEnvDecayParam);
+        (*this).setOscFrequency ((_op.isFixedMode ? _op.fixedFrequency : _freq) * _op.frequencyRatio);
+        (*this).setOscAmplitude (_op.level * _velocity);
+        osc.setUnison (_numUnisonVoices, _unisonDetune);
         env.noteOn();
-        if (*_param->pitchEnvOnParam == true)
+        if (_pitchEnv.isOn)
             pitchEnv.noteOn();
     }
 
@@ -127,23 +111,14 @@ public:
     }
 private:
     // base members
-    OscSwitch osc;                // oscillator with variable waveshape
+    UnisonOsc osc;                // unison oscillator with variable waveshape
     juce::ADSR env;               // amplitude envelope
     juce::ADSR pitchEnv;          // pitch envelope
     float frequency;              // oscillator frequency [Hz]
-    int pitchEnvInitialLevel = 0; // initial level for pitch envelope [semitones]
-    // modulation variables
-    float amplitudeOffset = 0.0f; // amplitude offset set by an external source
-    float phaseOffset = 0.0f;     // phase offset set by an external source
-    
-    /// reset external modulations for operator (amplitude and phase modulation)
-    void resetModulations()
-    {
-        amplitudeOffset = 0.0f;
-        osc.setAmplitudeOffset (0.0f);
-        phaseOffset = 0.0f;
-        osc.setPhaseOffset (0.0f);
-    }
+    float pitchEnvDepth = 0.0f;   // relative frequency change at the pitch envelope peak
+    // modulation buffers
+    const float* amplitudeModulation = nullptr; // amplitude modulation for the current block
+    const float* phaseModulation = nullptr;     // phase modulation for the current block
 };
 
 #endif // OPERATOR_H
\ No newline at end of file
@@ -1,11 +1,12 @@
 #ifndef OSC_SWITCH_H
 #define OSC_SWITCH_H
 
-#include <memory>        // for unique_ptr
 #include <cmath>         // for round()
 #include "Oscillators.h" // for using Phasor class and it's subclasses
 
 /// Oscillator class which can change waveshape using setWaveshape() method.
+/// Oscillators of all waveshapes are members of the class, so changing the waveshape
+/// on the audio thread only switches between them and doesn't allocate.
 class OscSwitch
 {
 public:
@@ -22,28 +23,26 @@ public:
     /// @param int, waveshape id (0 - sine, 1 - triangle, 2 - saw, 3 - square)
     void setWaveshape (int _waveshapeId)
     {
-        // detect if oscillator is already initialized and we're changing it's waveshape
-        bool rewrite = false;
-        if (osc != nullptr)
-            rewrite = true;
-        
+        // detect if oscillator is already initialized (the sample rate is set) and we're changing it's waveshape
+        bool rewrite = sampleRate > 0.0f;
+
         // set waveshape
         switch (_waveshapeId)
         {
         case 0:
-            osc.reset (new SinOsc());
+            osc = &sinOsc;
             break;
         case 1:
-            osc.reset (new TriOsc());
+            osc = &triOsc;
             break;
         case 2:
-            osc.reset (new SawOsc());
+            osc = &sawOsc;
             break;
         case 3:
-            osc.reset (new SqrOsc());
+            osc = &sqrOsc;
             break;
         default:
-            osc.reset (new Phasor());
+            osc = &phasor;
         }
 
         // set oscillator parameters if waveshape was overwritten
@@ -132,7 +131,12 @@ public:
         osc->setPhase (_phase);
     }
 private:
-    std::unique_ptr<Phasor> osc = nullptr; // carrier oscillator
+    Phasor* osc = &sinOsc; // current oscillator (one of the oscillators below)
+    SinOsc sinOsc;         // sine oscillator
+    TriOsc triOsc;         // triangle oscillator
+    SawOsc sawOsc;         // saw oscillator
+    SqrOsc sqrOsc;         // square oscillator
+    Phasor phasor;         // phasor (for unknown waveshape ids)
 
     // oscillator parameters (are stored so we can change oscillator waveshape in the process)
     float sampleRate = 0.0f;      // sample rate [Hz]
@@ -2,13 +2,20 @@
 #define OSCILLATORS_H
 
 #include <cmath>        // for sin(), powf()
+#include <cstdint>      // for uint32_t
+#include <atomic>       // for std::atomic
 #include <JuceHeader.h> // for jassert()
+#include "FastMath.h"   // for the sine and power of two approximations
+#include "Parameters.h" // for render quality tiers
 
 /// Base phasor class.
 /// A class is used as a base for building different oscillator forms.
 /// A class method process() processes phase value to output oscillator sample
 /// at that time. This method accounts for phase offset, amplitude, direct current
 /// and power which are specified using setter functions.
+/// Phase is kept in a 32-bit unsigned fixed-point accumulator (one cycle equals 2^32),
+/// so the wrap around is done by integer overflow and there is no precision loss
+/// for slow rates over long notes.
 class Phasor
 {
 public:
@@ -17,20 +24,19 @@ public:
     ///         direct current and power which are specified using setter functions)
     float process()
     {
-        phase += phaseDelta;
-        
-        if (phase > 1.0f)
-            phase -= 1.0f;
-        
-        return (amplitude + amplitudeOffset) * powf (output (phase + phaseOffset), power) + dc;
+        phase += phaseDelta; // wraps around by unsigned overflow
+        float sample = output (phase + phaseOffset);
+        if (power != 1.0f)
+            sample = powf (sample, power);
+        return (amplitude + amplitudeOffset) * sample + dc;
     }
     
     /// placeholder function to specify output of an oscillator
-    /// @param float, phase
+    /// @param uint32_t, fixed-point phase (one cycle equals 2^32)
     /// @return float, raw oscillator sample
-    virtual float output (float p)
+    virtual float output (uint32_t p)
     {
-        return p;
+        return toFloatPhase (p);
     }
     
     /// set sample rate
@@ -50,14 +56,14 @@ public:
             frequency = 0.5f * sampleRate;
         else
             frequency = fabs(_frequency);
-        phaseDelta = frequency / sampleRate;
+        phaseDelta = uint32_t (double (frequency) / double (sampleRate) * cycleLength + 0.5);
     }
     
     /// set phase offset (useful for phase modulation)
-    /// @param float, phase offset
+    /// @param float, phase offset (converted once to fixed-point, any value is wrapped into one cycle)
     void setPhaseOffset (float _phaseOffset)
     {
-        phaseOffset = _phaseOffset;
+        phaseOffset = toFixedPhase (_phaseOffset);
     }
 
     /// set amplitude (useful for amplitude modulation and LFOs)
@@ -94,25 +100,45 @@ public:
     /// @param float, phase (from 0 to 1)
     void setPhase (float _phase)
     {
-        phase = _phase;
+        phase = toFixedPhase (_phase);
     }
 
     /// get oscillator current phase
-    /// @return float, phase
+    /// @return float, phase (from 0 to 1)
     float getPhase()
     {
-        return phase;
+        return toFloatPhase (phase);
+    }
+
+protected:
+    /// convert phase in cycles to fixed-point phase
+    /// @param float, phase in cycles (can be negative or exceed one cycle)
+    /// @return uint32_t, fixed-point phase (fractional part of the cycle)
+    static uint32_t toFixedPhase (float _phase)
+    {
+        // conversion through a signed 64-bit integer keeps the wrap around modulo 2^32
+        return uint32_t (int64_t (double (_phase) * cycleLength));
+    }
+
+    /// convert fixed-point phase to phase in cycles
+    /// @param uint32_t, fixed-point phase
+    /// @return float, phase in range [0,1)
+    static float toFloatPhase (uint32_t _phase)
+    {
+        return float (double (_phase) * (1.0 / cycleLength));
     }
+
+    static constexpr double cycleLength = 4294967296.0; // fixed-point length of one cycle (2^32)
     
 private:
     // base parameters
     float frequency = 0.0f;   // frequency [Hz]
     float sampleRate = 0.0f;  // sample rate [Hz]
-    float phase = 0.0f;       // phase
-    float phaseDelta = 0.0f;  // phase delta
+    uint32_t phase = 0;       // fixed-point phase
+    uint32_t phaseDelta = 0;  // fixed-point phase delta
     float amplitude = 1.0f;   // amplitude
     // modulation parameters
-    float phaseOffset = 0.0f;     // phase offset
+    uint32_t phaseOffset = 0;     // fixed-point phase offset
     float amplitudeOffset = 0.0f; // amplitude offset
     float dc = 0.0f;              // direct current
     float power = 1.0f;           // power
@@ -123,29 +149,91 @@ class TriOsc : public Phasor
 {
 public:
     /// get triangle oscillator output
-    /// @param float, phase
+    /// @param uint32_t, fixed-point phase
     /// @return float, triangle oscillator output in range [-1,1]
-    float output(float p) override
+    float output(uint32_t fixedPhase) override
     {
         // the following function is used: 1 - 4*abs(1/2 - frac(1/2*p+1/4))
         // the reason for this form is that the waveshape has zero amplitude points
         // at p = 0, 1/2, 1 (the same as in sine oscillator)
+        float p = toFloatPhase (fixedPhase);
         float frac = (0.5f * p + 0.25f - (int)(0.5f * p + 0.25f));
         return 1.0f - 4.0f * fabsf(0.5f - frac);
     }
 };
 
-/// Sine oscillator
+/// Sine wavetable.
+/// The table is shared between plugin instances through the tables registry (see SharedTables.h),
+/// so it exists while at least one processor holds it. The live table is published to sine
+/// oscillators, which are created inside voices, with a static atomic pointer.
+struct SineTable
+{
+    static constexpr int tableBits = 11;             // wavetable size is 2^tableBits
+    static constexpr int tableSize = 1 << tableBits; // wavetable size
+
+    /// constructor which builds and publishes the table
+    /// @param double, unused (the table doesn't depend on the sample rate)
+    SineTable (double)
+    {
+        for (int i = 0; i <= tableSize; i++)
+            values[i] = float (std::sin (2.0 * 3.1415926535897932384626433832795 * i / tableSize));
+        current.store (this);
+    }
+
+    /// destructor which withdraws the table (unless another table was published)
+    ~SineTable()
+    {
+        const SineTable* self = this;
+        current.compare_exchange_strong (self, nullptr);
+    }
+
+    float values[tableSize + 1];                                     // wavetable with a guard point
+    inline static std::atomic<const SineTable*> current { nullptr }; // published table
+};
+
+/// Sine oscillator.
+/// Output is calculated with a polynomial (see FastMath.h) or, if fast math is switched off,
+/// read from a wavetable: the top bits of the fixed-point phase index the table directly
+/// and the remaining bits are used for linear interpolation.
 class SinOsc : public Phasor
 {
 public:
     /// get sine oscillator output
-    /// @param float, phase
+    /// @param uint32_t, fixed-point phase
     /// @return float, sine oscillator output in range [-1,1]
-    float output(float p) override
+    float output(uint32_t fixedPhase) override
+    {
+        return sine (fixedPhase);
+    }
+
+    /// calculate sine of a fixed-point phase
+    /// @param uint32_t, fixed-point phase
+    /// @return float, sine value in range [-1,1]
+    static float sine (uint32_t fixedPhase)
     {
-        return sin(p * 2 * 3.1415926535897932384626433832795f);
+#if PMSYNTH_FAST_MATH
+        // the signed conversion gives the phase in [-1/2, 1/2) and has a SIMD instruction
+        return FastMath::sinCycles (float (int32_t (fixedPhase)) * (1.0f / 4294967296.0f));
+#else
+        return lookup (fixedPhase);
+#endif
     }
+
+    /// read sine wavetable (the table should be held by the processor, see SineTable)
+    /// @param uint32_t, fixed-point phase
+    /// @return float, sine value in range [-1,1]
+    static float lookup (uint32_t fixedPhase)
+    {
+        const SineTable* sineTable = SineTable::current.load();
+        jassert (sineTable != nullptr);
+        const float* table = sineTable->values;
+        uint32_t idx = fixedPhase >> fracBits;
+        float frac = float (int32_t (fixedPhase & fracMask)) * (1.0f / float (fracMask + 1));
+        return table[idx] + frac * (table[idx + 1] - table[idx]);
+    }
+private:
+    static constexpr int fracBits = 32 - SineTable::tableBits;  // phase bits used for interpolation
+    static constexpr uint32_t fracMask = (1u << fracBits) - 1; // mask for interpolation bits
 };
 
 /// Square oscillator
@@ -153,9 +241,9 @@ class SqrOsc : public Phasor
 {
 public:
     /// get square oscillator output
-    /// @param float, phase
+    /// @param uint32_t, fixed-point phase
     /// @return float, square oscillator output in range [-1,1]
-    float output(float p) override
+    float output(uint32_t p) override
     {
         float outVal = 1.0f;
         if (p > pulseWidth)
@@ -167,10 +255,11 @@ public:
     /// @param float, pulse width in range [0,1]
     void setPulseWidth(float _pulseWidth)
     {
-        pulseWidth = _pulseWidth;
+        jassert (_pulseWidth >= 0.0f && _pulseWidth <= 1.0f);
+        pulseWidth = uint32_t (std::fmin (double (_pulseWidth) * cycleLength, cycleLength - 1.0));
     }
 private:
-    float pulseWidth = 0.5f;
+    uint32_t pulseWidth = 1u << 31; // fixed-point pulse width
 };
 
 /// Saw oscillator
@@ -178,11 +267,248 @@ class SawOsc : public Phasor
 {
 public:
     /// get saw oscillator output
-    /// @param float, phase
+    /// @param uint32_t, fixed-point phase
     /// @return float, saw oscillator output in range [-1,1]
-    float output(float p) override
+    float output(uint32_t p) override
+    {
+        return 2.0f * toFloatPhase (p) - 1.0f;
+    }
+};
+
+/// Unison oscillator class.
+/// A class instance renders several detuned copies (lanes) of one oscillator.
+/// Lanes share waveshape, amplitude and modulations, so only their phases and
+/// phase increments differ. Lane state is kept in arrays and every lane loop
+/// has a fixed number of iterations (the number of lanes is a template
+/// parameter), so the compiler can keep lanes in SIMD registers.
+class UnisonOsc
+{
+public:
+    static constexpr int maxLanes = 8; // maximum number of lanes
+
+    /// update phases and output the next sample for each lane
+    /// @param float, frequency of the centre lane [Hz]
+    /// @param const float*, phase offset for each lane (e.g. from modulating operators)
+    /// @param float, phase offset for all lanes (e.g. from LFOs)
+    /// @param float, amplitude offset for all lanes (e.g. from LFOs)
+    /// @param float, gain for all lanes (e.g. envelope value)
+    /// @param float*, output sample for each lane
+    template <int numLanes>
+    void process (float _frequency, const float* _phaseOffset, float _commonPhaseOffset, float _amplitudeOffset, float _gain, float* _out)
+    {
+        static_assert (numLanes >= 1 && numLanes <= maxLanes, "unsupported number of lanes");
+        float scale = (amplitude + _amplitudeOffset) * _gain;
+        uint32_t p[numLanes];
+        uint32_t delta[numLanes];
+        for (int k = 0; k < numLanes; k++)
+        {
+            delta[k] = uint32_t (int32_t (std::fmin (_frequency * laneScale[k], maxPhaseDelta)));
+            phase[k] += delta[k]; // wraps around by unsigned overflow
+        }
+        // offline quality keeps the full precision of phase offsets
+        if (quality == Parameters::offlineQuality)
+        {
+            for (int k = 0; k < numLanes; k++)
+                p[k] = phase[k] + toFixedPhasePrecise (_phaseOffset[k] + _commonPhaseOffset);
+        }
+        else
+        {
+            for (int k = 0; k < numLanes; k++)
+                p[k] = phase[k] + toFixedPhase (_phaseOffset[k] + _commonPhaseOffset);
+        }
+        // waveshapes are selected once for all lanes
+        switch (kernel)
+        {
+        case sineKernel:
+            for (int k = 0; k < numLanes; k++)
+                _out[k] = scale * SinOsc::sine (p[k]);
+            break;
+        case triangleKernel:
+            for (int k = 0; k < numLanes; k++)
+            {
+                // the same function as in TriOsc class
+                float frac = 0.5f * toFloatPhase (p[k]) + 0.25f;
+                _out[k] = scale * (1.0f - 4.0f * fabsf (0.5f - frac));
+            }
+            break;
+        case sawKernel:
+            for (int k = 0; k < numLanes; k++)
+                _out[k] = scale * (2.0f * toFloatPhase (p[k]) - 1.0f);
+            break;
+        case squareKernel:
+            for (int k = 0; k < numLanes; k++)
+                _out[k] = p[k] > (1u << 31) ? -scale : scale;
+            break;
+        case draftSineKernel:
+            for (int k = 0; k < numLanes; k++)
+                _out[k] = scale * FastMath::sinCyclesDraft (float (int32_t (p[k])) * (1.0f / 4294967296.0f));
+            break;
+        case exactSineKernel:
+            for (int k = 0; k < numLanes; k++)
+                _out[k] = scale * float (std::sin (double (p[k]) * (2.0 * 3.1415926535897932384626433832795 / cycleLength)));
+            break;
+        case bandLimitedSawKernel:
+            for (int k = 0; k < numLanes; k++)
+            {
+                float t = toFloatPhase (p[k]);
+                _out[k] = scale * (2.0f * t - 1.0f - polyBlep (t, toFloatDelta (delta[k])));
+            }
+            break;
+        case bandLimitedSquareKernel:
+            for (int k = 0; k < numLanes; k++)
+            {
+                float dt = toFloatDelta (delta[k]);
+                float naive = p[k] > (1u << 31) ? -1.0f : 1.0f;
+                _out[k] = scale * (naive + polyBlep (toFloatPhase (p[k]), dt) - polyBlep (toFloatPhase (p[k] + (1u << 31)), dt));
+            }
+            break;
+        default:
+            for (int k = 0; k < numLanes; k++)
+                _out[k] = scale * toFloatPhase (p[k]);
+        }
+    }
+
+    /// set sample rate
+    /// @param float, sample rate in Hz
+    void setSampleRate (float _sampleRate)
+    {
+        jassert (_sampleRate > 0.0f); // check sample rate value
+        sampleRate = _sampleRate;
+    }
+
+    /// set oscillator waveshape
+    /// @param int, waveshape id (0 - sine, 1 - triangle, 2 - saw, 3 - square)
+    void setWaveshape (int _waveshapeId)
+    {
+        waveshape = _waveshapeId;
+        updateKernel();
+    }
+
+    /// set render quality (draft quality uses the cheap parabolic sine, offline quality
+    /// uses the exact sine, band-limited saw and square and precise phase offsets)
+    /// @param int, quality tier (see Parameters.h)
+    void setQuality (int _quality)
+    {
+        quality = _quality;
+        updateKernel();
+    }
+
+    /// set amplitude
+    /// @param float, amplitude
+    void setAmplitude (float _amplitude)
+    {
+        amplitude = _amplitude;
+    }
+
+    /// set number of lanes and their detune (lanes are spread evenly between the detune bounds
+    /// and lanes after the first one start with evenly spread phases so they don't sum in phase)
+    /// @param int, number of lanes
+    /// @param float, detune of the outer lanes [cents]
+    void setUnison (int _numLanes, float _detune)
+    {
+        jassert (sampleRate > 0.0f); // check if sample rate is set (the default value on initialization is 0)
+        jassert (_numLanes >= 1 && _numLanes <= maxLanes);
+        for (int k = 0; k < maxLanes; k++)
+        {
+            float position = (_numLanes > 1 && k < _numLanes) ? 2.0f * float (k) / float (_numLanes - 1) - 1.0f : 0.0f;
+#if PMSYNTH_FAST_MATH
+            laneScale[k] = FastMath::exp2 (position * _detune / 1200.0f) / sampleRate * float (cycleLength);
+#else
+            laneScale[k] = float (std::pow (2.0, position * _detune / 1200.0) / sampleRate * cycleLength);
+#endif
+            if (k > 0)
+                phase[k] = phase[0] + uint32_t (double (k % _numLanes) / double (_numLanes) * cycleLength);
+        }
+    }
+
+private:
+    static constexpr double cycleLength = 4294967296.0;   // fixed-point length of one cycle (2^32)
+    static constexpr float maxPhaseDelta = 2147483520.0f; // largest float below half a cycle (Nyquist frequency)
+
+    // waveshape kernels (waveshape implementations for quality tiers)
+    static constexpr int sineKernel = 0;              // sine (the implementation is selected by the fast math switch)
+    static constexpr int triangleKernel = 1;          // triangle
+    static constexpr int sawKernel = 2;               // saw
+    static constexpr int squareKernel = 3;            // square
+    static constexpr int draftSineKernel = 4;         // cheap sine approximation (draft quality)
+    static constexpr int exactSineKernel = 5;         // sine calculated in double precision
+    static constexpr int bandLimitedSawKernel = 6;    // saw with polynomial band-limited steps
+    static constexpr int bandLimitedSquareKernel = 7; // square with polynomial band-limited steps
+
+    float sampleRate = 0.0f;                   // sample rate [Hz]
+    int waveshape = 0;                         // waveshape id
+    int quality = Parameters::realtimeQuality; // render quality tier
+    int kernel = sineKernel;                   // waveshape kernel for the waveshape and quality
+    float amplitude = 1.0f;                    // amplitude
+    uint32_t phase[maxLanes] = {};             // fixed-point phase for each lane
+    float laneScale[maxLanes] = {};            // conversion from frequency [Hz] to fixed-point phase delta for each lane (includes detune)
+
+    /// convert phase in cycles to fixed-point phase (with 24-bit precision, which is float precision,
+    /// using only conversions which have SIMD instructions)
+    /// @param float, phase in cycles (can be negative or exceed one cycle)
+    /// @return uint32_t, fixed-point phase
+    static uint32_t toFixedPhase (float _phase)
+    {
+        float frac = _phase - std::floor (_phase);
+        return uint32_t (int32_t (frac * 16777216.0f)) << 8;
+    }
+
+    /// convert phase in cycles to fixed-point phase with full precision
+    /// @param float, phase in cycles (can be negative or exceed one cycle)
+    /// @return uint32_t, fixed-point phase
+    static uint32_t toFixedPhasePrecise (float _phase)
+    {
+        // conversion through a signed 64-bit integer keeps the wrap around modulo 2^32
+        return uint32_t (int64_t (double (_phase) * cycleLength));
+    }
+
+    /// convert fixed-point phase to phase in cycles
+    /// @param uint32_t, fixed-point phase
+    /// @return float, phase in range [0,1)
+    static float toFloatPhase (uint32_t _phase)
+    {
+        return float (int32_t (_phase >> 8)) * (1.0f / 16777216.0f);
+    }
+
+    /// convert fixed-point phase delta (below half a cycle) to phase delta in cycles
+    /// @param uint32_t, fixed-point phase delta
+    /// @return float, phase delta in range [0,0.5)
+    static float toFloatDelta (uint32_t _delta)
+    {
+        return float (int32_t (_delta)) * (1.0f / 4294967296.0f);
+    }
+
+    /// polynomial band-limited step: correction of a unit step smoothed over one sample on each side
+    /// @param float, phase since the step [cycles]
+    /// @param float, phase delta [cycles]
+    /// @return float, correction to subtract from a falling step (to add to a rising one)
+    static float polyBlep (float _t, float _dt)
+    {
+        if (_t < _dt)
+        {
+            float x = _t / _dt;
+            return x + x - x * x - 1.0f;
+        }
+        if (_t > 1.0f - _dt)
+        {
+            float x = (_t - 1.0f) / _dt;
+            return x * x + x + x + 1.0f;
+        }
+        return 0.0f;
+    }
+
+    /// select waveshape kernel for the current waveshape and quality
+    void updateKernel()
     {
-        return 2.0f * p - 1.0f;
+        kernel = waveshape;
+        if (waveshape == 0 && quality == Parameters::draftQuality)
+            kernel = draftSineKernel;
+        else if (waveshape == 0 && quality == Parameters::offlineQuality)
+            kernel = exactSineKernel;
+        else if (waveshape == 2 && quality == Parameters::offlineQuality)
+            kernel = bandLimitedSawKernel;
+        else if (waveshape == 3 && quality == Parameters::offlineQuality)
+            kernel = bandLimitedSquareKernel;
     }
 };
 
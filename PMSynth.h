@@ -2,12 +2,19 @@
 #define PM_SYNTH_H
 
 
-#include <JuceHeader.h> // for JUCE classes
-#include "Operator.h"   // for operators
-#include "Algorithm.h"  // for phase modulation algorithm
-#include "Filter.h"     // for filter
-#include "LFO.h"        // for LFOs
-#include "Parameters.h" // for accessing parameters set by the user interface
+#include <JuceHeader.h>    // for JUCE classes
+#include <algorithm>       // for std::copy
+#include <limits>          // for std::numeric_limits
+#include "Operator.h"      // for operators
+#include "Algorithm.h"     // for phase modulation algorithm
+#include "Filter.h"        // for filter
+#include "LFO.h"           // for LFOs
+#include "ModMatrix.h"     // for LFOs routing
+#include "SharedLFOs.h"    // for LFOs shared by all voices
+#include "VoiceTemplate.h" // for values derived from parameters when notes start
+#include "Parameters.h"    // for accessing parameters set by the user interface
+#include "PresetBank.h"    // for switching presets on MIDI Program Change
+#include "SimdDispatch.h"  // for kernels compiled for SIMD tiers
 
 /// Synthesizer sound class
 class PMSynthSound : public juce::SynthesiserSound
@@ -18,20 +25,115 @@ public:
     bool appliesToChannel   (int) override { return true; }
 };
 
+/// Base synthesizer voice class.
+/// Keeps the state which the synthesizer uses for load-aware voice
+/// stealing: the output level of the last rendered block and a fast
+/// release (a short fade out which ends the voice).
+class PMSynthVoiceBase : public juce::SynthesiserVoice
+{
+public:
+    /// start a fast release which fades the voice out and ends it
+    void startFastRelease()
+    {
+        if (isFastReleasing)
+            return;
+        isFastReleasing = true;
+        fadeGain = 1.0f;
+        fadeStep = 1.0f / juce::jmax (1.0f, fastReleaseTime * float (getSampleRate()));
+    }
+
+    /// check if the voice is in a fast release
+    /// @return bool, true if the voice is fading out
+    bool isInFastRelease() const
+    {
+        return isFastReleasing;
+    }
+
+    /// get voice level
+    /// @return float, peak level of the last rendered block (before the filter)
+    float getLevel() const
+    {
+        return level;
+    }
+
+    /// set render quality of the voice DSP
+    /// @param int, quality tier (see Parameters.h)
+    virtual void setQuality (int _quality) = 0;
+
+    /// set SIMD tier of the voice kernels
+    /// @param int, tier (see SimdDispatch.h)
+    void setSimdTier (int _simdTier)
+    {
+        simdTier = _simdTier;
+    }
+
+protected:
+    static constexpr float fastReleaseTime = 0.005f; // fast release time [sec]
+    int simdTier = SimdDispatch::sse2Tier;           // SIMD tier of the voice kernels
+    float level = 0.0f;                              // peak level of the last rendered block
+    bool isFastReleasing = false;                    // flag for a voice in the fast release
+    float fadeGain = 1.0f;                           // fast release gain
+    float fadeStep = 0.0f;                           // fast release gain decrement per sample
+
+    /// reset level and fast release when a note starts
+    void resetVoiceState()
+    {
+        level = 0.0f;
+        isFastReleasing = false;
+        fadeGain = 1.0f;
+    }
+
+    /// apply the fast release fade to a rendered block
+    /// @param float* const*, pointers to channels of the block
+    /// @param int, number of channels
+    /// @param int, number of samples
+    /// @return bool, true if the fade has ended
+    bool applyFastRelease (float* const* _channels, int _numChannels, int _numSamples)
+    {
+        for (int n = 0; n < _numSamples; n++)
+        {
+            fadeGain = juce::jmax (fadeGain - fadeStep, 0.0f);
+            for (int chan = 0; chan < _numChannels; chan++)
+                _channels[chan][n] *= fadeGain;
+        }
+        return fadeGain == 0.0f;
+    }
+};
+
  /// Synthesizer voice class.
  /// Each voice corresponts to one note when synthesizer is
  /// played polyphonically. This class handles all of the DSP
- /// associated with the synthesizer.
-class PMSynthVoice : public juce::SynthesiserVoice
+ /// associated with the synthesizer. In unison mode a voice
+ /// renders several detuned sub-voices which share envelopes,
+ /// LFOs, algorithm and filter: operator chains of sub-voices
+ /// are processed together as lanes of one oscillator.
+ /// A released voice ends early once its level stays below
+ /// a threshold for a hold time: envelopes only decay in
+ /// the release stage and the level is checked against the
+ /// filter gain bound, so the voice can't become audible again.
+/// Voices with a level of an output operator modulated by an
+/// LFO aren't ended early, since the modulation can bring
+/// their sound back.
+ /// The number of operators is a template parameter, so
+ /// loops over operators have a fixed number of iterations.
+template <int numOperators>
+class PMSynthVoice : public PMSynthVoiceBase
 {
 public:
     /// constructor synthesizer voice which handles parameters assignment
     /// @param Parameters*, pointer to parameters set by the user interface
-    PMSynthVoice(Parameters* _param) :
+    /// @param SharedLFOs*, pointer to LFOs shared by all voices
+    /// @param VoiceTemplates*, pointer to voice templates
+    PMSynthVoice(Parameters* _param, SharedLFOs* _sharedLFOs, VoiceTemplates* _voiceTemplates) :
         param (_param),
         filter (_param->apvts.getParameterRange("filterFrequency"), _param->apvts.getParameterRange("filterResonance")),
-        lfo {_param->apvts.getParameterRange("lfo1Rate"), _param->apvts.getParameterRange("lfo2Rate")}
+        lfo {_param->apvts.getParameterRange("lfo1Rate"), _param->apvts.getParameterRange("lfo2Rate")},
+        modMatrix (_param->numOperators, _param->numLFOs),
+        sharedLFOs (_sharedLFOs),
+        voiceTemplates (_voiceTemplates)
     {
+        jassert (_param->numOperators == numOperators);
+        random.setSeedRandomly();
     }
 
     /// update synthesizer's elements when a note starts playing
@@ -41,25 +143,33 @@ public:
     /// @param int, unused
     void startNote (int midiNoteNumber, float velocity, juce::SynthesiserSound*, int /*currentPitchWheelPosition*/) override
     {
+        // values derived from parameters come from the template, the note adds pitch and velocity
+        const VoiceTemplate& voiceTemplate = voiceTemplates->get();
+        // prepare unison
+        numUnisonVoices = voiceTemplate.numUnisonVoices;
+        numActiveLanes = voiceTemplate.numActiveLanes;
+        isStereo = voiceTemplate.isStereo;
+        std::copy (&voiceTemplate.laneGain[0][0], &voiceTemplate.laneGain[0][0] + 2 * UnisonOsc::maxLanes, &laneGain[0][0]);
+        // prepare level follower
+        endThreshold = voiceTemplate.endThreshold;
+        endHoldSamples = int (endHoldTime * getSampleRate());
+        // prepare pan
+        updatePan (midiNoteNumber, voiceTemplate.panMode, voiceTemplate.panAmount);
+        silentSamples = 0;
+        isReleased = false;
+        resetVoiceState();
         // prepare operators
         float freqMidi = juce::MidiMessage::getMidiNoteInHertz (midiNoteNumber);
-        for (int i = 0; i < param->numOperators; i++)
-        {
-            float freq = 0.0f;
-            if (*param->opFixedModeParam[i] == false)
-                freq = freqMidi;
-            else
-                freq = *param->opFixedFreqParam[i];
-            ops[i].startNote (param, i, freq, velocity, getSampleRate());
-        }
+        for (int i = 0; i < numOperators; i++)
+            ops[i].startNote (voiceTemplate.ops[i], voiceTemplate.pitchEnv, freqMidi, velocity, float (getSampleRate()), numUnisonVoices, voiceTemplate.unisonDetune);
         // prepare algorithm
-        algorithm.startNote (param);
+        algorithm.startNote (voiceTemplate.algorithm, voiceTemplate.feedback);
         // prepare filter
-        filter.startNote (param, getSampleRate());
+        filter.startNote (voiceTemplate.filter, float (getSampleRate()));
         // prepare LFOs
         for (int i = 0; i < param->numLFOs; i++)
         {
-            lfo[i].startNote (param, i, getSampleRate());
+            lfo[i].startNote (voiceTemplate.lfos[i], float (getSampleRate()));
         }
         playing = true;
     }
@@ -69,9 +179,17 @@ public:
     /// @param bool, flag to do a tail-off
     void stopNote(float /*velocity*/, bool allowTailOff) override
     {
-        for (int i = 0; i < param->numOperators; i++)
+        // stop immediately when there should be no tail (e.g. on reset)
+        if (allowTailOff == false)
+        {
+            clearCurrentNote();
+            playing = false;
+            return;
+        }
+        for (int i = 0; i < numOperators; i++)
             ops[i].stopNote();
         filter.stopNote();
+        isReleased = true;
     }
 
     /// synthesize next block of samples
@@ -83,70 +201,35 @@ public:
         // check if this voice should be playing
         if (playing)
         {
-            // iterate through the necessary number of samples (from startSample up to startSample + numSamples)
-            for (int sampleIndex = startSample; sampleIndex < (startSample + numSamples); sampleIndex++)
+            // unison voices are rendered in a power of two number of lanes
+            switch (numActiveLanes)
             {
-                // apply LFOs
-                for (int i = 0; i < param->numLFOs; i++)
-                {
-                    // check on/off switch
-                    if (*param->lfoOnParam[i] == false)
-                        continue;
-                    // get LFO sample
-                    int lfoDestination = *param->lfoDestinationParam[i];
-                    float lfoSample = lfo[i].process();
-                    // operators level modulation
-                    if (lfo[i].isAppliedToOpLevel (lfoDestination, param->numOperators))
-                        ops[lfoDestination].setOscAmplitudeOffset (lfoSample);
-                    // operators phases modulation
-                    if (lfo[i].isAppliedToOpsPhase (lfoDestination, param->numOperators))
-                    {
-                        for (int j = 0; j < param->numOperators; j++)
-                            ops[j].setOscPhaseOffset (lfoSample);
-                    }
-                    // filter frequency modulation
-                    if (lfo[i].isAppliedToFilterFreq (lfoDestination, param->numOperators))
-                        filter.setFrequencyOffset (lfoSample);
-                    // filter resonance modulation
-                    if (lfo[i].isAppliedToFilterRes (lfoDestination, param->numOperators))
-                        filter.setResonanceOffset (lfoSample);
-                    // previous LFO rate modulation
-                    if (lfo[i].isAppliedToLFORate (lfoDestination, param->numOperators, param->numLFOs))
-                        lfo[i-1].setFrequencyOffset (lfoSample);
-                    // previous LFO amount modulation
-                    if (lfo[i].isAppliedToLFOAmount (lfoDestination, param->numOperators, param->numLFOs))
-                        lfo[i-1].setAmountOffset (lfoSample);
-                }
-                // process PM algorithm
-                bool isOutput[4] = {false};
-                float algorithmOut = algorithm.process(ops, isOutput);
-                // process filter
-                float filterOut;
-                if (*param->filterOnParam == true)
-                    filterOut = filter.process (algorithmOut);
-                else
-                    filterOut = algorithmOut;
-                // write the current sample to the output buffer for each channel
-                float outSample = filterOut;
-                for (int chan = 0; chan < outputBuffer.getNumChannels(); chan++)
-                    outputBuffer.addSample (chan, sampleIndex, 0.3f * outSample);
-                // check envelope end for output operators
-                bool isActive = false;
-                for (int i = 0; i < param->numOperators; i++)
-                {   
-                    if (isOutput[i] == true)
-                        isActive = isActive || ops[i].isEnvActive();
-                }
-                // clear current note
-                if (isActive == false)
-                {
-                    clearCurrentNote();
-                    playing = false;
-                }
+            case 1:
+                renderLanesForTier<1> (outputBuffer, startSample, numSamples);
+                break;
+            case 2:
+                renderLanesForTier<2> (outputBuffer, startSample, numSamples);
+                break;
+            case 4:
+                renderLanesForTier<4> (outputBuffer, startSample, numSamples);
+                break;
+            default:
+                renderLanesForTier<8> (outputBuffer, startSample, numSamples);
             }
         }
     }
     
+    /// set render quality of operators, filter and LFOs
+    /// @param int, quality tier (see Parameters.h)
+    void setQuality (int _quality) override
+    {
+        for (int i = 0; i < numOperators; i++)
+            ops[i].setQuality (_quality);
+        filter.setQuality (_quality);
+        for (int i = 0; i < param->numLFOs; i++)
+            lfo[i].setQuality (_quality);
+    }
+
     void pitchWheelMoved(int) override {}
     
     void controllerMoved(int, int) override {}
@@ -162,13 +245,541 @@ private:
     bool playing = false; // flag for voice output
 
     // base members
-    Operator ops[4];      // four operators
-    Algorithm algorithm;  // phase modulation algorithm
-    Filter filter;        // filter
-    LFO lfo[2];           // two LFOs
+    Operator ops[numOperators];        // operators
+    Algorithm<numOperators> algorithm; // phase modulation algorithm
+    Filter filter;                     // filter
+    LFO lfo[2];                        // two LFOs
+    ModMatrix modMatrix;               // LFOs routing
+    SharedLFOs* sharedLFOs;            // LFOs shared by all voices (free-running LFOs)
+    VoiceTemplates* voiceTemplates;    // values derived from parameters when notes start
+
+    // unison
+    int numUnisonVoices = 1;                                          // number of unison voices
+    int numActiveLanes = 1;                                           // number of rendered lanes (power of two)
+    bool isStereo = false;                                            // flag for unison voices spread in stereo
+    float laneGain[2][UnisonOsc::maxLanes] = {};                      // left and right gains for each lane
+
+    // level follower
+    static constexpr float endHoldTime = 0.05f;                       // time the level should stay below the threshold before the voice ends [sec]
+    float endThreshold = 0.0f;                                        // level below which a released voice ends
+    int endHoldSamples = 0;                                           // hold time [samples]
+    int silentSamples = 0;                                            // number of samples since the level was above the threshold
+    bool isReleased = false;                                          // flag for a voice in the release stage
+
+    // output
+    static constexpr float outputGain = 0.3f;                         // voice output gain
+    float voiceBlock[2][ModMatrix::blockSize];                        // voice output for the current modulation block (mono or stereo)
+    float panGain[2] = { outputGain, outputGain };                    // left and right output gains
+    juce::Random random;                                              // random generator for random pan
 
     // parameters pointer
     Parameters* param;    // parameters set by the user interface
+
+    /// mix the rendered voice block into the output buffer with pan gains
+    /// @param AudioSampleBuffer&, output buffer
+    /// @param int, start sample position
+    /// @param int, number of samples
+    /// @param bool, flag for the stereo voice block
+    void mixVoiceBlock (juce::AudioSampleBuffer& outputBuffer, int startSample, int numSamples, bool isStereoBlock)
+    {
+        if (numSamples == 0)
+            return;
+        int numChannels = outputBuffer.getNumChannels();
+        if (numChannels == 1)
+        {
+            SimdDispatch::addWithMultiply (outputBuffer.getWritePointer (0, startSample), voiceBlock[0], outputGain, numSamples);
+            return;
+        }
+        for (int chan = 0; chan < numChannels; chan++)
+        {
+            // channels above the stereo pair get the unpanned mono output
+            const float* source = voiceBlock[isStereoBlock ? juce::jmin (chan, 1) : 0];
+            float gain = chan < 2 ? panGain[chan] : outputGain;
+            SimdDispatch::addWithMultiply (outputBuffer.getWritePointer (chan, startSample), source, gain, numSamples);
+        }
+    }
+
+    /// update output gains for the voice pan
+    /// @param int, MIDI note number
+    /// @param int, pan mode
+    /// @param float, pan amount
+    void updatePan (int _midiNoteNumber, int _panMode, float _panAmount)
+    {
+        float pan = 0.0f;
+        switch (_panMode)
+        {
+        case 1:
+            // note spread: lower notes to the left and higher notes to the right of the middle C
+            pan = juce::jlimit (-1.0f, 1.0f, float (_midiNoteNumber - 60) / 48.0f);
+            break;
+        case 2:
+            // random pan for every note
+            pan = 2.0f * random.nextFloat() - 1.0f;
+            break;
+        }
+        pan *= _panAmount;
+        // balance pan law (the same as for unison voices)
+        panGain[0] = outputGain * (1.0f - juce::jmax (pan, 0.0f));
+        panGain[1] = outputGain * (1.0f + juce::jmin (pan, 0.0f));
+    }
+
+    /// synthesize next block of samples with the kernel for the SIMD tier
+    /// @param AudioSampleBuffer&, output buffer
+    /// @param int, start sample position
+    /// @param int, number of samples
+    template <int numLanes>
+    void renderLanesForTier (juce::AudioSampleBuffer& outputBuffer, int startSample, int numSamples)
+    {
+#if PMSYNTH_SIMD_DISPATCH
+        if (simdTier == SimdDispatch::avx512Tier)
+            return renderLanesAvx512<numLanes> (outputBuffer, startSample, numSamples);
+        if (simdTier == SimdDispatch::avx2Tier)
+            return renderLanesAvx2<numLanes> (outputBuffer, startSample, numSamples);
+#endif
+        renderLanes<numLanes> (outputBuffer, startSample, numSamples);
+    }
+
+#if PMSYNTH_SIMD_DISPATCH
+    /// AVX2 kernel of renderLanes()
+    template <int numLanes>
+    PMSYNTH_SIMD_AVX2 void renderLanesAvx2 (juce::AudioSampleBuffer& outputBuffer, int startSample, int numSamples)
+    {
+        renderLanes<numLanes> (outputBuffer, startSample, numSamples);
+    }
+
+    /// AVX-512 kernel of renderLanes()
+    template <int numLanes>
+    PMSYNTH_SIMD_AVX512 void renderLanesAvx512 (juce::AudioSampleBuffer& outputBuffer, int startSample, int numSamples)
+    {
+        renderLanes<numLanes> (outputBuffer, startSample, numSamples);
+    }
+#endif
+
+    /// synthesize next block of samples with a fixed number of unison lanes
+    /// @param AudioSampleBuffer&, output buffer
+    /// @param int, start sample position
+    /// @param int, number of samples
+    template <int numLanes>
+    void renderLanes (juce::AudioSampleBuffer& outputBuffer, int startSample, int numSamples)
+    {
+        bool isStereoOutput = isStereo && outputBuffer.getNumChannels() > 1;
+        // iterate through the necessary number of samples in modulation blocks
+        while (playing && numSamples > 0)
+        {
+            int blockSamples = juce::jmin (numSamples, ModMatrix::blockSize);
+            int numRenderedSamples = 0;
+            float peak = 0.0f;
+            renderModulations (blockSamples);
+            // output level threshold before the filter which can amplify the signal
+            bool isFilterOn = *param->filterOnParam == true && *param->filterParaphonicParam == false;
+            float levelThreshold = endThreshold / outputGain;
+            if (*param->filterOnParam == true)
+                levelThreshold /= filter.getMaxGain (modMatrix.isDestinationRouted (modMatrix.getFilterResonanceDestination()));
+            // a modulated level of an output operator can bring a quiet voice back, so such voices aren't ended by their level
+            bool isOutputLevelModulated = false;
+            for (int i = 0; i < numOperators; i++)
+            {
+                if (algorithm.isOutput (i) && modMatrix.isDestinationRouted (modMatrix.getOpLevelDestination (i)))
+                    isOutputLevelModulated = true;
+            }
+            for (int n = 0; n < blockSamples; n++)
+            {
+                // process PM algorithm for all unison lanes
+                float laneOut[UnisonOsc::maxLanes];
+                algorithm.template process<numLanes> (ops, n, laneOut);
+                // mix lanes
+                float left = 0.0f;
+                float right = 0.0f;
+                for (int k = 0; k < numLanes; k++)
+                {
+                    left += laneGain[0][k] * laneOut[k];
+                    right += laneGain[1][k] * laneOut[k];
+                }
+                // follow the level
+                float magnitude = juce::jmax (std::abs (left), std::abs (right));
+                peak = juce::jmax (peak, magnitude);
+                if (magnitude >= levelThreshold)
+                    silentSamples = 0;
+                else
+                    silentSamples++;
+                // process filter (is bypassed in paraphonic mode) and write the current sample to the voice block
+                if (isStereoOutput)
+                {
+                    if (isFilterOn)
+                        filter.processStereo (left, right, n);
+                    voiceBlock[0][n] = left;
+                    voiceBlock[1][n] = right;
+                }
+                else
+                {
+                    float filterOut = 0.5f * (left + right);
+                    if (isFilterOn)
+                        filterOut = filter.process (filterOut, n);
+                    voiceBlock[0][n] = filterOut;
+                }
+                numRenderedSamples = n + 1;
+                // check envelope end for output operators
+                bool isActive = false;
+                for (int i = 0; i < numOperators; i++)
+                {
+                    if (algorithm.isOutput (i) == true)
+                        isActive = isActive || ops[i].isEnvActive();
+                }
+                // check level of a released voice
+                if (isReleased && isOutputLevelModulated == false && silentSamples >= endHoldSamples)
+                    isActive = false;
+                // clear current note
+                if (isActive == false)
+                {
+                    clearCurrentNote();
+                    playing = false;
+                    break;
+                }
+            }
+            level = outputGain * peak;
+            // fade out a voice stolen by the synthesizer
+            if (isFastReleasing)
+            {
+                float* channels[2] = { voiceBlock[0], voiceBlock[1] };
+                if (applyFastRelease (channels, isStereoOutput ? 2 : 1, numRenderedSamples) && playing)
+                {
+                    clearCurrentNote();
+                    playing = false;
+                }
+            }
+            mixVoiceBlock (outputBuffer, startSample, numRenderedSamples, isStereoOutput);
+            startSample += blockSamples;
+            numSamples -= blockSamples;
+        }
+    }
+
+    /// render LFOs for the next modulation block and pass modulation buffers to their destinations
+    /// @param int, number of samples in the block
+    void renderModulations (int numSamples)
+    {
+        modMatrix.beginBlock (param, numSamples);
+        // an LFO can only modulate LFOs with a lower index, so LFOs are rendered in reverse order
+        for (int i = param->numLFOs - 1; i >= 0; i--)
+        {
+            if (modMatrix.isSourceRouted (i) == false)
+                continue;
+            // a free-running LFO is rendered once for all voices
+            if (const float* sharedOutput = sharedLFOs->getOutput (i))
+            {
+                modMatrix.applyRoutes (i, sharedOutput, numSamples);
+                continue;
+            }
+            int rateDestination = modMatrix.getLFORateDestination (i);
+            lfo[i].process (modMatrix.getSourceBuffer (i),
+                            modMatrix.isDestinationRouted (rateDestination) ? modMatrix.getDestination (rateDestination) : nullptr,
+                            modMatrix.getDestination (modMatrix.getLFOAmountDestination (i)),
+                            numSamples);
+            modMatrix.applyRoutes (i, numSamples);
+        }
+        // pass modulation buffers to operators and filter
+        for (int i = 0; i < numOperators; i++)
+            ops[i].setModulationBuffers (modMatrix.getDestination (modMatrix.getOpLevelDestination (i)),
+                                         modMatrix.getDestination (modMatrix.getOpsPhaseDestination()));
+        filter.setModulationBuffers (modMatrix.getDestination (modMatrix.getFilterFrequencyDestination()),
+                                     modMatrix.getDestination (modMatrix.getFilterResonanceDestination()));
+    }
+};
+
+/// Synthesizer class.
+/// Handles MIDI Program Change messages by switching presets
+/// in the preset bank at the exact sample position of the message.
+/// In paraphonic filter mode voices bypass their own filters and a
+/// single shared filter processes the sum of voices. The shared filter
+/// envelope is triggered by the first held note and released with the
+/// last one. Polyphony adapts to the processing load: when a block takes
+/// more than the CPU budget of its duration, the voice limit is lowered
+/// and the extra voices (released, quiet or old ones first) are faded out
+/// quickly. The limit is raised again while the load stays low.
+class PMSynthesiser : public juce::Synthesiser
+{
+public:
+    /// constructor which assigns parameters and the preset bank
+    /// @param Parameters*, pointer to parameters set by the user interface
+    /// @param PresetBank*, pointer to the preset bank
+    PMSynthesiser (Parameters* _param, PresetBank* _presetBank) :
+        param (_param),
+        presetBank (_presetBank),
+        sharedFilter (_param->apvts.getParameterRange("filterFrequency"), _param->apvts.getParameterRange("filterResonance")),
+        voiceTemplates (_param),
+        sharedLFOs (_param)
+    {
+        // the shared filter isn't modulated by LFOs
+        sharedFilter.setModulationBuffers (zeros, zeros);
+    }
+
+    /// get LFOs shared by all voices
+    /// @return SharedLFOs*, shared LFOs
+    SharedLFOs* getSharedLFOs()
+    {
+        return &sharedLFOs;
+    }
+
+    /// get voice templates
+    /// @return VoiceTemplates*, voice templates
+    VoiceTemplates* getVoiceTemplates()
+    {
+        return &voiceTemplates;
+    }
+
+    /// set sample rate of voices and shared LFOs (and publish the template for the current parameters)
+    /// @param double, sample rate [Hz]
+    void setCurrentPlaybackSampleRate (double _sampleRate) override
+    {
+        juce::Synthesiser::setCurrentPlaybackSampleRate (_sampleRate);
+        voiceTemplates.update();
+        sharedLFOs.prepare (float (_sampleRate));
+    }
+
+    /// start a note and the shared filter envelope if no other notes are held
+    /// @param int, MIDI channel
+    /// @param int, MIDI note number
+    /// @param float, velocity
+    void noteOn (int midiChannel, int midiNoteNumber, float velocity) override
+    {
+        if (isFilterEnvOn == false)
+        {
+            sharedFilter.startNote (voiceTemplates.get().filter, float (getSampleRate()));
+            isFilterEnvOn = true;
+            isSharedFilterStarted = true;
+        }
+        if (isNoteHeld[midiNoteNumber] == false)
+        {
+            isNoteHeld[midiNoteNumber] = true;
+            numHeldNotes++;
+        }
+        // keep the number of voices within the limit set by the CPU budget
+        if (getNumPlayingVoices() >= voiceLimit)
+            fastReleaseVoice();
+        juce::Synthesiser::noteOn (midiChannel, midiNoteNumber, velocity);
+    }
+
+    /// stop a note and release the shared filter envelope if it was the last held note
+    /// @param int, MIDI channel
+    /// @param int, MIDI note number
+    /// @param float, velocity
+    /// @param bool, flag to do a tail-off
+    void noteOff (int midiChannel, int midiNoteNumber, float velocity, bool allowTailOff) override
+    {
+        if (isNoteHeld[midiNoteNumber])
+        {
+            isNoteHeld[midiNoteNumber] = false;
+            numHeldNotes--;
+        }
+        updateFilterEnvRelease();
+        juce::Synthesiser::noteOff (midiChannel, midiNoteNumber, velocity, allowTailOff);
+    }
+
+    /// handle sustain pedal (the shared filter envelope is held while the pedal is down)
+    /// @param int, MIDI channel
+    /// @param bool, flag for pedal down
+    void handleSustainPedal (int midiChannel, bool isDown) override
+    {
+        isSustainPedalDown = isDown;
+        updateFilterEnvRelease();
+        juce::Synthesiser::handleSustainPedal (midiChannel, isDown);
+    }
+
+    /// stop all notes and release the shared filter envelope
+    /// @param int, MIDI channel (0 for all channels)
+    /// @param bool, flag to do a tail-off
+    void allNotesOff (int midiChannel, bool allowTailOff) override
+    {
+        for (auto& isHeld : isNoteHeld)
+            isHeld = false;
+        numHeldNotes = 0;
+        updateFilterEnvRelease();
+        juce::Synthesiser::allNotesOff (midiChannel, allowTailOff);
+    }
+
+    /// set render quality of all voices and the shared filter
+    /// @param int, quality tier (see Parameters.h)
+    void setQuality (int _quality)
+    {
+        const juce::ScopedLock sl (lock);
+        for (int i = 0; i < getNumVoices(); i++)
+        {
+            if (auto* voice = dynamic_cast<PMSynthVoiceBase*> (getVoice (i)))
+                voice->setQuality (_quality);
+        }
+        sharedFilter.setQuality (_quality);
+        sharedLFOs.setQuality (_quality);
+    }
+
+    /// set SIMD tier of the voice and shared filter kernels
+    /// @param int, tier (see SimdDispatch.h)
+    void setSimdTier (int _simdTier)
+    {
+        const juce::ScopedLock sl (lock);
+        for (int i = 0; i < getNumVoices(); i++)
+        {
+            if (auto* voice = dynamic_cast<PMSynthVoiceBase*> (getVoice (i)))
+                voice->setSimdTier (_simdTier);
+        }
+        simdTier = _simdTier;
+    }
+
+    /// adapt polyphony to the processing load of the last block
+    /// @param float, processing time of the last block relative to its duration
+    void setProcessingLoad (float _load)
+    {
+        const juce::ScopedLock sl (lock);
+        float budget = *param->voiceCpuBudgetParam / 100.0f;
+        int numPlaying = getNumPlayingVoices();
+        if (_load > budget && numPlaying > 1)
+        {
+            // processing time is roughly proportional to the number of voices
+            int numToRelease = juce::jmax (1, int (std::ceil (float (numPlaying) * (1.0f - budget / _load))));
+            voiceLimit = juce::jmax (1, numPlaying - numToRelease);
+            for (int i = 0; i < numToRelease; i++)
+                fastReleaseVoice();
+        }
+        else if (_load < recoveryLoadRatio * budget && voiceLimit < getNumVoices())
+        {
+            voiceLimit++;
+        }
+    }
+
+protected:
+    /// handle MIDI message
+    /// @param const juce::MidiMessage&, MIDI message
+    void handleMidiEvent (const juce::MidiMessage& m) override
+    {
+        if (m.isProgramChange())
+            presetBank->selectPresetRealtime (m.getProgramChangeNumber());
+        juce::Synthesiser::handleMidiEvent (m);
+    }
+
+    /// render shared LFOs and voices in modulation blocks and apply the shared filter in paraphonic mode
+    /// @param juce::AudioBuffer<float>&, output buffer
+    /// @param int, start sample position
+    /// @param int, number of samples
+    void renderVoices (juce::AudioBuffer<float>& outputAudio, int startSample, int numSamples) override
+    {
+        // voices render one modulation block per call, which starts with the block of shared LFOs
+        for (int offset = 0; offset < numSamples; offset += ModMatrix::blockSize)
+        {
+            int blockSamples = juce::jmin (ModMatrix::blockSize, numSamples - offset);
+            sharedLFOs.process (blockSamples);
+            juce::Synthesiser::renderVoices (outputAudio, startSample + offset, blockSamples);
+        }
+        if (*param->filterOnParam == false || *param->filterParaphonicParam == false || isSharedFilterStarted == false)
+            return;
+#if PMSYNTH_SIMD_DISPATCH
+        if (simdTier == SimdDispatch::avx512Tier)
+            return processSharedFilterAvx512 (outputAudio, startSample, numSamples);
+        if (simdTier == SimdDispatch::avx2Tier)
+            return processSharedFilterAvx2 (outputAudio, startSample, numSamples);
+#endif
+        processSharedFilter (outputAudio, startSample, numSamples);
+    }
+
+private:
+    Parameters* param;                  // parameters set by the user interface
+    PresetBank* presetBank;             // preset bank
+    // paraphonic filter
+    Filter sharedFilter;                // filter shared by all voices
+    const float zeros[1] = { 0.0f };    // modulation buffer for the shared filter
+    bool isNoteHeld[128] = {};          // flags for held MIDI notes
+    int numHeldNotes = 0;               // number of held MIDI notes
+    bool isSustainPedalDown = false;    // flag for sustain pedal down
+    bool isFilterEnvOn = false;         // flag for the shared filter envelope before its release
+    bool isSharedFilterStarted = false; // flag for the shared filter prepared by the first note
+    // note start
+    VoiceTemplates voiceTemplates;      // values derived from parameters when notes start
+    // free-running LFOs
+    SharedLFOs sharedLFOs;              // LFOs shared by all voices
+    // adaptive polyphony
+    static constexpr float recoveryLoadRatio = 0.8f;  // part of the CPU budget below which the voice limit is raised
+    int voiceLimit = std::numeric_limits<int>::max(); // maximum number of playing voices
+    // kernels
+    int simdTier = SimdDispatch::sse2Tier;            // SIMD tier of the shared filter kernel
+
+    /// apply the shared filter
+    /// @param juce::AudioBuffer<float>&, output buffer
+    /// @param int, start sample position
+    /// @param int, number of samples
+    void processSharedFilter (juce::AudioBuffer<float>& outputAudio, int startSample, int numSamples)
+    {
+        if (outputAudio.getNumChannels() > 1)
+        {
+            float* left = outputAudio.getWritePointer (0, startSample);
+            float* right = outputAudio.getWritePointer (1, startSample);
+            for (int n = 0; n < numSamples; n++)
+                sharedFilter.processStereo (left[n], right[n], 0);
+        }
+        else
+        {
+            float* samples = outputAudio.getWritePointer (0, startSample);
+            for (int n = 0; n < numSamples; n++)
+                samples[n] = sharedFilter.process (samples[n], 0);
+        }
+    }
+
+#if PMSYNTH_SIMD_DISPATCH
+    /// AVX2 kernel of processSharedFilter()
+    PMSYNTH_SIMD_AVX2 void processSharedFilterAvx2 (juce::AudioBuffer<float>& outputAudio, int startSample, int numSamples)
+    {
+        processSharedFilter (outputAudio, startSample, numSamples);
+    }
+
+    /// AVX-512 kernel of processSharedFilter()
+    PMSYNTH_SIMD_AVX512 void processSharedFilterAvx512 (juce::AudioBuffer<float>& outputAudio, int startSample, int numSamples)
+    {
+        processSharedFilter (outputAudio, startSample, numSamples);
+    }
+#endif
+
+    /// count voices which are playing and aren't fading out
+    /// @return int, number of voices
+    int getNumPlayingVoices() const
+    {
+        int numPlaying = 0;
+        for (int i = 0; i < getNumVoices(); i++)
+        {
+            auto* voice = dynamic_cast<PMSynthVoiceBase*> (getVoice (i));
+            if (voice != nullptr && voice->isVoiceActive() && voice->isInFastRelease() == false)
+                numPlaying++;
+        }
+        return numPlaying;
+    }
+
+    /// start a fast release of the voice which is the least noticeable to stop:
+    /// released voices go first, then quieter and older ones
+    void fastReleaseVoice()
+    {
+        PMSynthVoiceBase* chosen = nullptr;
+        for (int i = 0; i < getNumVoices(); i++)
+        {
+            auto* voice = dynamic_cast<PMSynthVoiceBase*> (getVoice (i));
+            if (voice == nullptr || voice->isVoiceActive() == false || voice->isInFastRelease())
+                continue;
+            if (chosen == nullptr)
+                chosen = voice;
+            else if (voice->isKeyDown() != chosen->isKeyDown())
+                chosen = voice->isKeyDown() ? chosen : voice;
+            else if (voice->getLevel() != chosen->getLevel())
+                chosen = voice->getLevel() < chosen->getLevel() ? voice : chosen;
+            else if (voice->wasStartedBefore (*chosen))
+                chosen = voice;
+        }
+        if (chosen != nullptr)
+            chosen->startFastRelease();
+    }
+
+    /// release the shared filter envelope when no notes are held or sustained
+    void updateFilterEnvRelease()
+    {
+        if (isFilterEnvOn && numHeldNotes == 0 && isSustainPedalDown == false)
+        {
+            sharedFilter.stopNote();
+            isFilterEnvOn = false;
+        }
+    }
 };
 
 #endif // !PM_SYNTH_H
\ No newline at end of file
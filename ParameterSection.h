@@ -0,0 +1,171 @@
+#ifndef PARAMETER_SECTION_H
+#define PARAMETER_SECTION_H
+
+#include <JuceHeader.h> // for JUCE classes
+#include <vector>       // for std::vector
+#include "Parameters.h" // for accessing parameters set by the user interface
+
+/// Parameter section class.
+/// A class instance draws and edits all parameters of a parameter group in a single
+/// component (there is no component per parameter). Parameters are drawn as cells with
+/// a name, a value and a bar: dragging a cell changes its value, clicking a switch or
+/// a choice steps through its values and double-clicking resets the default value.
+/// The section doesn't listen to parameters: update() repaints it only when the group
+/// version has changed, so any number of changes between two updates costs one repaint.
+class ParameterSection : public juce::Component
+{
+public:
+    static constexpr int titleHeight = 20; // height of the section title [px]
+    static constexpr int cellHeight = 34;  // height of a parameter cell [px]
+    static constexpr int numColumns = 2;   // number of cell columns
+
+    /// constructor which collects parameters of a group
+    /// @param const juce::String&, section title
+    /// @param Parameters*, pointer to the parameters class
+    /// @param int, parameters group
+    ParameterSection (const juce::String& _title, Parameters* _param, int _group) :
+        title (_title), param (_param), group (_group)
+    {
+        setOpaque (true);
+        for (auto* parameter : param->getGroupParameters (group))
+        {
+            // names have a "Section: " prefix which is shown in the title
+            juce::String name = parameter->getName (64);
+            if (name.contains (": "))
+                name = name.fromFirstOccurrenceOf (": ", false, false);
+            cells.push_back ({ parameter, name, {} });
+        }
+    }
+
+    /// get height which fits all parameters
+    /// @return int, height [px]
+    int getPreferredHeight() const
+    {
+        return titleHeight + cellHeight * ((int (cells.size()) + numColumns - 1) / numColumns) + 4;
+    }
+
+    /// repaint the section if any of its parameters has changed since the last update
+    void update()
+    {
+        if (param->hasChanged (group, seenVersion))
+            repaint();
+    }
+
+    void paint (juce::Graphics& g) override
+    {
+        g.fillAll (juce::Colour (0xff202428));
+        g.setColour (juce::Colour (0xff3a4048));
+        g.drawRect (getLocalBounds());
+        g.setColour (juce::Colours::white);
+        g.setFont (juce::Font (14.0f).withStyle (juce::Font::bold));
+        g.drawText (title, getLocalBounds().removeFromTop (titleHeight).reduced (6, 0), juce::Justification::centredLeft);
+        g.setFont (12.0f);
+        for (auto& cell : cells)
+        {
+            auto area = cell.bounds.reduced (4, 2);
+            auto textArea = area.removeFromTop (16);
+            g.setColour (juce::Colours::lightgrey);
+            g.drawText (cell.name, textArea, juce::Justification::centredLeft);
+            g.setColour (juce::Colours::white);
+            g.drawText (cell.parameter->getCurrentValueAsText(), textArea, juce::Justification::centredRight);
+            auto bar = area.reduced (0, 3).toFloat();
+            g.setColour (juce::Colour (0xff30363e));
+            g.fillRect (bar);
+            g.setColour (juce::Colour (0xffe08a2c));
+            g.fillRect (bar.withWidth (bar.getWidth() * cell.parameter->getValue()));
+        }
+    }
+
+    void resized() override
+    {
+        int cellWidth = getWidth() / numColumns;
+        for (size_t i = 0; i < cells.size(); i++)
+        {
+            int column = int (i) % numColumns, row = int (i) / numColumns;
+            cells[i].bounds = { column * cellWidth, titleHeight + row * cellHeight, cellWidth, cellHeight };
+        }
+    }
+
+    void mouseDown (const juce::MouseEvent& e) override
+    {
+        dragCell = findCell (e.getPosition());
+        if (dragCell == nullptr)
+            return;
+        juce::RangedAudioParameter* parameter = dragCell->parameter;
+        parameter->beginChangeGesture();
+        dragStartValue = parameter->getValue();
+        // switches and choices step through their values on click
+        if (isStepped (parameter))
+        {
+            int numSteps = parameter->getNumSteps();
+            int step = (juce::roundToInt (dragStartValue * float (numSteps - 1)) + 1) % numSteps;
+            parameter->setValueNotifyingHost (float (step) / float (numSteps - 1));
+        }
+    }
+
+    void mouseDrag (const juce::MouseEvent& e) override
+    {
+        if (dragCell == nullptr || isStepped (dragCell->parameter))
+            return;
+        // full range in 200 pixels of vertical drag (ten times finer with shift)
+        float sensitivity = e.mods.isShiftDown() ? 0.0005f : 0.005f;
+        float value = dragStartValue + float (e.getDistanceFromDragStartX() - e.getDistanceFromDragStartY()) * sensitivity;
+        dragCell->parameter->setValueNotifyingHost (juce::jlimit (0.0f, 1.0f, value));
+    }
+
+    void mouseUp (const juce::MouseEvent&) override
+    {
+        if (dragCell != nullptr)
+            dragCell->parameter->endChangeGesture();
+        dragCell = nullptr;
+    }
+
+    void mouseDoubleClick (const juce::MouseEvent& e) override
+    {
+        if (Cell* cell = findCell (e.getPosition()))
+        {
+            cell->parameter->beginChangeGesture();
+            cell->parameter->setValueNotifyingHost (cell->parameter->getDefaultValue());
+            cell->parameter->endChangeGesture();
+        }
+    }
+
+private:
+    /// parameter cell
+    struct Cell
+    {
+        juce::RangedAudioParameter* parameter; // parameter
+        juce::String name;                     // parameter name without the section prefix
+        juce::Rectangle<int> bounds;           // cell bounds
+    };
+
+    juce::String title;                                   // section title
+    Parameters* param;                                    // pointer to parameters set by the user interface
+    int group;                                            // parameters group
+    juce::uint32 seenVersion = Parameters::unseenVersion; // last drawn version of the group
+    std::vector<Cell> cells;                              // parameter cells
+    Cell* dragCell = nullptr;                             // cell being edited with the mouse
+    float dragStartValue = 0.0f;                          // normalised value at the start of the drag
+
+    /// find a cell at a position
+    /// @param juce::Point<int>, position in the section
+    /// @return Cell*, cell or nullptr if there is no cell at the position
+    Cell* findCell (juce::Point<int> _position)
+    {
+        for (auto& cell : cells)
+            if (cell.bounds.contains (_position))
+                return &cell;
+        return nullptr;
+    }
+
+    /// check if a parameter is a switch or a choice
+    /// @param juce::RangedAudioParameter*, parameter
+    /// @return bool, true for parameters which are stepped by clicks
+    static bool isStepped (juce::RangedAudioParameter* _parameter)
+    {
+        return dynamic_cast<juce::AudioParameterBool*> (_parameter) != nullptr
+            || dynamic_cast<juce::AudioParameterChoice*> (_parameter) != nullptr;
+    }
+};
+
+#endif // PARAMETER_SECTION_H
@@ -3,6 +3,8 @@
 
 #include <JuceHeader.h> // for JUCE classes
 #include <string>       // for std::string
+#include <vector>       // for std::vector
+#include <cstring>      // for std::memcpy
 
 /// Parameters class.
 /// This class handles creation of parameter layout
@@ -10,7 +12,8 @@
 /// parameter pointers to public variables of this
 /// class. A pointer to a Parameters class can be
 /// passed to any other class where access to user
-/// defined parameters is needed.
+/// defined parameters is needed. The class also
+/// handles saving and loading of the plugin state.
 class Parameters
 {
 public:
@@ -18,54 +21,68 @@ public:
     juce::AudioProcessorValueTreeState apvts;
 
     // define number of operators and oscillators in the synth
+    static constexpr int maxOperators = 8; // maximum number of operators in a build
     const int numOperators;
     const int numLFOs;
 
     // operators parameters
-    std::atomic<float>* algorithm;                 // algorithm number
-    std::atomic<float>* opLevelParam[4];           // operators' levels
-    std::atomic<float>* opCoarseParam[4];          // operators' coarse frequency
-    std::atomic<float>* opFineParam[4];            // operators' fine frequency
-    std::atomic<float>* opWaveshapeParam[4];       // operators' waveshape
-    std::atomic<float>* opAttackParam[4];          // attack for operators' amplitudes
-    std::atomic<float>* opDecayParam[4];           // decay for operators' amplitudes
-    std::atomic<float>* opSustainParam[4];         // sustain for operators' amplitudes
-    std::atomic<float>* opReleaseParam[4];         // release for operators' amplitudes
-    std::atomic<float>* opFixedModeParam[4];       // on/off switch for operators' fixed frequency mode
-    std::atomic<float>* opFixedFreqParam[4];       // fixed frequency for operators' amplitudes
+    std::atomic<float>* algorithm;                      // algorithm number
+    std::atomic<float>* feedbackParam = nullptr;        // feedback amount (only for builds with more than four operators)
+    std::atomic<float>* opLevelParam[maxOperators];     // operators' levels
+    std::atomic<float>* opCoarseParam[maxOperators];    // operators' coarse frequency
+    std::atomic<float>* opFineParam[maxOperators];      // operators' fine frequency
+    std::atomic<float>* opWaveshapeParam[maxOperators]; // operators' waveshape
+    std::atomic<float>* opAttackParam[maxOperators];    // attack for operators' amplitudes
+    std::atomic<float>* opDecayParam[maxOperators];     // decay for operators' amplitudes
+    std::atomic<float>* opSustainParam[maxOperators];   // sustain for operators' amplitudes
+    std::atomic<float>* opReleaseParam[maxOperators];   // release for operators' amplitudes
+    std::atomic<float>* opFixedModeParam[maxOperators]; // on/off switch for operators' fixed frequency mode
+    std::atomic<float>* opFixedFreqParam[maxOperators]; // fixed frequency for operators' amplitudes
     // filter parameters
-    std::atomic<float>* filterOnParam;             // on/off switch for filter
-    std::atomic<float>* filterTypeParam;           // filter type
-    std::atomic<float>* filterFrequencyParam;      // filter cutoff frequency
-    std::atomic<float>* filterResonanceParam;      // filter resonance
-    std::atomic<float>* filterEnvAmountParam;      // amount for the cutoff envelope
-    std::atomic<float>* filterAttackParam;         // attack for the cutoff envelope
-    std::atomic<float>* filterDecayParam;          // decay for the cutoff envelope
-    std::atomic<float>* filterSustainParam;        // sustain for the cutoff envelope
-    std::atomic<float>* filterReleaseParam;        // release for the cutoff envelope
+    std::atomic<float>* filterOnParam;                  // on/off switch for filter
+    std::atomic<float>* filterTypeParam;                // filter type
+    std::atomic<float>* filterFrequencyParam;           // filter cutoff frequency
+    std::atomic<float>* filterResonanceParam;           // filter resonance
+    std::atomic<float>* filterEnvAmountParam;           // amount for the cutoff envelope
+    std::atomic<float>* filterAttackParam;              // attack for the cutoff envelope
+    std::atomic<float>* filterDecayParam;               // decay for the cutoff envelope
+    std::atomic<float>* filterSustainParam;             // sustain for the cutoff envelope
+    std::atomic<float>* filterReleaseParam;             // release for the cutoff envelope
+    std::atomic<float>* filterParaphonicParam;          // paraphonic mode switch (one filter shared by all voices)
     // LFOs parameters
-    std::atomic<float>* lfoOnParam[2];             // on/off switch for LFOs
-    std::atomic<float>* lfoDestinationParam[2];    // LFOs destinations
-    std::atomic<float>* lfoWaveshapeParam[2];      // LFOs waveshapes
-    std::atomic<float>* lfoRateParam[2];           // LFOs rate
-    std::atomic<float>* lfoAmountParam[2];         // LFOs amount
-    std::atomic<float>* lfoRetriggerParam[2];      // LFOs retrigger switch
+    std::atomic<float>* lfoOnParam[2];                  // on/off switch for LFOs
+    std::atomic<float>* lfoDestinationParam[2];         // LFOs destinations
+    std::atomic<float>* lfoWaveshapeParam[2];           // LFOs waveshapes
+    std::atomic<float>* lfoRateParam[2];                // LFOs rate
+    std::atomic<float>* lfoAmountParam[2];              // LFOs amount
+    std::atomic<float>* lfoRetriggerParam[2];           // LFOs retrigger switch
     // pitch envelope parameters
-    std::atomic<float>* pitchEnvOnParam;           // on/off switch for operators pitch envelope
-    std::atomic<float>* pitchEnvInitialLevelParam; // initial level for pitch envelope
-    std::atomic<float>* pitchEnvDecayParam;        // decay for pitch envelope
+    std::atomic<float>* pitchEnvOnParam;                // on/off switch for operators pitch envelope
+    std::atomic<float>* pitchEnvInitialLevelParam;      // initial level for pitch envelope
+    std::atomic<float>* pitchEnvDecayParam;             // decay for pitch envelope
     // delay parameters
-    std::atomic<float>* delayOnParam;              // on/off switch for delay
-    std::atomic<float>* delayDryWetParam;          // delay dry/wet
-    std::atomic<float>* delayTimeParam[2];         // delay time for left/right channels
-    std::atomic<float>* delayTimeLinkParam;        // delay stereo link switch
-    std::atomic<float>* delayFeedbackParam;        // delay feedback
+    std::atomic<float>* delayOnParam;                   // on/off switch for delay
+    std::atomic<float>* delayDryWetParam;               // delay dry/wet
+    std::atomic<float>* delayTimeParam[2];              // delay time for left/right channels
+    std::atomic<float>* delayTimeLinkParam;             // delay stereo link switch
+    std::atomic<float>* delayFeedbackParam;             // delay feedback
     // reverb parameters
-    std::atomic<float>* reverbOnParam;             // on/off switch for reverb
-    std::atomic<float>* reverbDryWetParam;         // reverb dry/wet
-    std::atomic<float>* reverbRoomSizeParam;       // reverb room size
-    std::atomic<float>* reverbWidthParam;          // reverb width
-    std::atomic<float>* reverbDampingParam;        // reverb damping
+    std::atomic<float>* reverbOnParam;                  // on/off switch for reverb
+    std::atomic<float>* reverbDryWetParam;              // reverb dry/wet
+    std::atomic<float>* reverbRoomSizeParam;            // reverb room size
+    std::atomic<float>* reverbWidthParam;               // reverb width
+    std::atomic<float>* reverbDampingParam;             // reverb damping
+    // unison parameters
+    std::atomic<float>* unisonVoicesParam;              // number of unison voices per note
+    std::atomic<float>* unisonDetuneParam;              // detune of the outer unison voices [cents]
+    std::atomic<float>* unisonSpreadParam;              // stereo spread of unison voices
+    // voice parameters
+    std::atomic<float>* voiceEndThresholdParam;         // level below which a released voice is ended [dBFS]
+    std::atomic<float>* voicePanModeParam;              // voice pan mode
+    std::atomic<float>* voicePanAmountParam;            // voice pan amount
+    std::atomic<float>* voiceCpuBudgetParam;            // part of the block duration the processing may take before polyphony is lowered [%]
+    std::atomic<float>* qualityParam;                   // render quality tier
+    std::atomic<float>* pipelinedParam;                 // flag for effects processed in parallel with the next block of the synthesizer
     
     /// create parameters layout
     /// @param int, number of operators in the synthesizer
@@ -76,7 +93,12 @@ public:
         juce::AudioProcessorValueTreeState::ParameterLayout layout; // parameters layout
         juce::StringArray lfoDestinations;                          // possible destinations for LFOs
         // algorithm
-        layout.add (std::make_unique<juce::AudioParameterChoice> ("algorithm", "PM algorithm", juce::StringArray{"1", "2", "3", "4", "5", "6", "7", "8", "9", "10", "11"}, 0));
+        juce::StringArray algorithms;
+        for (int i = 0; i < getNumAlgorithms (numOperators); i++)
+            algorithms.add (juce::String (i + 1));
+        layout.add (std::make_unique<juce::AudioParameterChoice> ("algorithm", "PM algorithm", algorithms, 0));
+        if (numOperators > 4)
+            layout.add (std::make_unique<juce::AudioParameterFloat> ("feedback", "PM feedback", 0.0f, 1.0f, 0.0f));
         // operators layout
         for (int i = 0; i < numOperators; i++)
         {
@@ -145,6 +167,23 @@ public:
         layout.add (std::make_unique<juce::AudioParameterFloat> ("reverbRoomSize", "Reverb: room size", 0.0f, 1.0f, 0.5f));
         layout.add (std::make_unique<juce::AudioParameterFloat> ("reverbWidth", "Reverb: width", 0.0f, 1.0f, 0.5f));
         layout.add (std::make_unique<juce::AudioParameterFloat> ("reverbDamping", "Reverb: damping", 0.0f, 1.0f, 0.5f));
+        // unison (new parameters are appended to the end of the layout so older states can still be loaded)
+        layout.add (std::make_unique<juce::AudioParameterInt> ("unisonVoices", "Unison: voices", 1, 8, 1));
+        layout.add (std::make_unique<juce::AudioParameterFloat> ("unisonDetune", "Unison: detune", 0.0f, 50.0f, 10.0f));
+        layout.add (std::make_unique<juce::AudioParameterFloat> ("unisonSpread", "Unison: stereo spread", 0.0f, 1.0f, 0.5f));
+        // voice
+        layout.add (std::make_unique<juce::AudioParameterFloat> ("voiceEndThreshold", "Voice: end threshold", -120.0f, -48.0f, -96.0f));
+        // paraphonic filter
+        layout.add (std::make_unique<juce::AudioParameterBool> ("filterParaphonic", "Filter: paraphonic", false));
+        // voice pan
+        layout.add (std::make_unique<juce::AudioParameterChoice> ("voicePanMode", "Voice: pan mode", juce::StringArray{"Centre", "Note spread", "Random"}, 0));
+        layout.add (std::make_unique<juce::AudioParameterFloat> ("voicePanAmount", "Voice: pan amount", 0.0f, 1.0f, 0.5f));
+        // adaptive polyphony
+        layout.add (std::make_unique<juce::AudioParameterFloat> ("voiceCpuBudget", "Voice: CPU budget", 10.0f, 100.0f, 70.0f));
+        // render quality (offline quality is used automatically for non-realtime rendering)
+        layout.add (std::make_unique<juce::AudioParameterChoice> ("quality", "Quality", juce::StringArray{"Draft", "Realtime", "Offline"}, realtimeQuality));
+        // pipelined processing (adds one block of latency)
+        layout.add (std::make_unique<juce::AudioParameterBool> ("pipelined", "Pipelined effects", false));
         return layout;
     }
 
@@ -156,65 +195,363 @@ public:
         numOperators (_numOperators), numLFOs (_numLFOs), 
         apvts (audioProcessor, nullptr, "ParameterTree", createParameterLayout(_numOperators, _numLFOs))
     {
+        // change tracking for parameter groups
+        groupVersions.reset (new std::atomic<juce::uint32>[size_t (getNumGroups())]());
+        groupParameters.resize (size_t (getNumGroups()));
         // algorithm
-        algorithm = apvts.getRawParameterValue ("algorithm");
+        algorithm = getTrackedParameter ("algorithm", algorithmGroup);
+        if (numOperators > 4)
+            feedbackParam = getTrackedParameter ("feedback", algorithmGroup);
         // operators parameters
         for (int i = 0; i < numOperators; i++)
         {
             std::string paramIdBase ("op");
             paramIdBase.push_back (getLetter (i));
-            opWaveshapeParam[i] = apvts.getRawParameterValue (paramIdBase + "Waveshape");;
-            opCoarseParam[i] = apvts.getRawParameterValue (paramIdBase + "Coarse");
-            opFineParam[i] = apvts.getRawParameterValue (paramIdBase + "Fine");
-            opLevelParam[i] = apvts.getRawParameterValue (paramIdBase + "Level");
-            opAttackParam[i] = apvts.getRawParameterValue (paramIdBase + "Attack");
-            opDecayParam[i] = apvts.getRawParameterValue (paramIdBase + "Decay");
-            opSustainParam[i] = apvts.getRawParameterValue (paramIdBase + "Sustain");
-            opReleaseParam[i] = apvts.getRawParameterValue (paramIdBase + "Release");
-            opFixedModeParam[i] = apvts.getRawParameterValue (paramIdBase + "FixedMode");
-            opFixedFreqParam[i] = apvts.getRawParameterValue (paramIdBase + "FixedFreq");
+            opWaveshapeParam[i] = getTrackedParameter (paramIdBase + "Waveshape", getOperatorGroup (i));
+            opCoarseParam[i] = getTrackedParameter (paramIdBase + "Coarse", getOperatorGroup (i));
+            opFineParam[i] = getTrackedParameter (paramIdBase + "Fine", getOperatorGroup (i));
+            opLevelParam[i] = getTrackedParameter (paramIdBase + "Level", getOperatorGroup (i));
+            opAttackParam[i] = getTrackedParameter (paramIdBase + "Attack", getOperatorGroup (i));
+            opDecayParam[i] = getTrackedParameter (paramIdBase + "Decay", getOperatorGroup (i));
+            opSustainParam[i] = getTrackedParameter (paramIdBase + "Sustain", getOperatorGroup (i));
+            opReleaseParam[i] = getTrackedParameter (paramIdBase + "Release", getOperatorGroup (i));
+            opFixedModeParam[i] = getTrackedParameter (paramIdBase + "FixedMode", getOperatorGroup (i));
+            opFixedFreqParam[i] = getTrackedParameter (paramIdBase + "FixedFreq", getOperatorGroup (i));
         }
         // filter parameters
-        filterOnParam = apvts.getRawParameterValue ("filterOn");
-        filterTypeParam = apvts.getRawParameterValue ("filterType");
-        filterFrequencyParam = apvts.getRawParameterValue ("filterFrequency");
-        filterResonanceParam = apvts.getRawParameterValue ("filterResonance");
-        filterEnvAmountParam = apvts.getRawParameterValue ("filterEnvAmount");
-        filterAttackParam = apvts.getRawParameterValue ("filterAttack");
-        filterDecayParam = apvts.getRawParameterValue ("filterDecay");
-        filterSustainParam = apvts.getRawParameterValue ("filterSustain");
-        filterReleaseParam = apvts.getRawParameterValue ("filterRelease");
+        filterOnParam = getTrackedParameter ("filterOn", filterGroup);
+        filterTypeParam = getTrackedParameter ("filterType", filterGroup);
+        filterFrequencyParam = getTrackedParameter ("filterFrequency", filterGroup);
+        filterResonanceParam = getTrackedParameter ("filterResonance", filterGroup);
+        filterEnvAmountParam = getTrackedParameter ("filterEnvAmount", filterGroup);
+        filterAttackParam = getTrackedParameter ("filterAttack", filterGroup);
+        filterDecayParam = getTrackedParameter ("filterDecay", filterGroup);
+        filterSustainParam = getTrackedParameter ("filterSustain", filterGroup);
+        filterReleaseParam = getTrackedParameter ("filterRelease", filterGroup);
+        filterParaphonicParam = getTrackedParameter ("filterParaphonic", filterGroup);
         // LFOs parameters
         for (int i = 0; i < numLFOs; i++)
         {
             std::string paramIdBase ("lfo");
             paramIdBase += std::to_string (i + 1);
-            lfoOnParam[i] = apvts.getRawParameterValue (paramIdBase + "On");
-            lfoDestinationParam[i] = apvts.getRawParameterValue (paramIdBase + "Destination");
-            lfoWaveshapeParam[i] = apvts.getRawParameterValue (paramIdBase + "Waveshape");
-            lfoRateParam[i] = apvts.getRawParameterValue (paramIdBase + "Rate");
-            lfoAmountParam[i] = apvts.getRawParameterValue (paramIdBase + "Amount");
-            lfoRetriggerParam[i] = apvts.getRawParameterValue (paramIdBase + "Retrigger");
+            lfoOnParam[i] = getTrackedParameter (paramIdBase + "On", getLFOGroup (i));
+            lfoDestinationParam[i] = getTrackedParameter (paramIdBase + "Destination", getLFOGroup (i));
+            lfoWaveshapeParam[i] = getTrackedParameter (paramIdBase + "Waveshape", getLFOGroup (i));
+            lfoRateParam[i] = getTrackedParameter (paramIdBase + "Rate", getLFOGroup (i));
+            lfoAmountParam[i] = getTrackedParameter (paramIdBase + "Amount", getLFOGroup (i));
+            lfoRetriggerParam[i] = getTrackedParameter (paramIdBase + "Retrigger", getLFOGroup (i));
         }
         // pitch envelope
-        pitchEnvOnParam = apvts.getRawParameterValue ("pitchEnvOn");
-        pitchEnvInitialLevelParam = apvts.getRawParameterValue ("pitchEnvInitialLevel");
-        pitchEnvDecayParam = apvts.getRawParameterValue ("pitchEnvDecay");
+        pitchEnvOnParam = getTrackedParameter ("pitchEnvOn", pitchEnvGroup);
+        pitchEnvInitialLevelParam = getTrackedParameter ("pitchEnvInitialLevel", pitchEnvGroup);
+        pitchEnvDecayParam = getTrackedParameter ("pitchEnvDecay", pitchEnvGroup);
         // delay
-        delayOnParam = apvts.getRawParameterValue ("delayOn");
-        delayDryWetParam = apvts.getRawParameterValue ("delayDryWet");
-        delayTimeParam[0] = apvts.getRawParameterValue ("delayTimeLeft");
-        delayTimeParam[1] = apvts.getRawParameterValue ("delayTimeRight");
-        delayTimeLinkParam = apvts.getRawParameterValue ("delayTimeLink");
-        delayFeedbackParam = apvts.getRawParameterValue ("delayFeedback");
+        delayOnParam = getTrackedParameter ("delayOn", delayGroup);
+        delayDryWetParam = getTrackedParameter ("delayDryWet", delayGroup);
+        delayTimeParam[0] = getTrackedParameter ("delayTimeLeft", delayGroup);
+        delayTimeParam[1] = getTrackedParameter ("delayTimeRight", delayGroup);
+        delayTimeLinkParam = getTrackedParameter ("delayTimeLink", delayGroup);
+        delayFeedbackParam = getTrackedParameter ("delayFeedback", delayGroup);
         // reverb
-        reverbOnParam = apvts.getRawParameterValue ("reverbOn");
-        reverbDryWetParam = apvts.getRawParameterValue ("reverbDryWet");
-        reverbRoomSizeParam = apvts.getRawParameterValue ("reverbRoomSize");
-        reverbWidthParam = apvts.getRawParameterValue ("reverbWidth");
-        reverbDampingParam = apvts.getRawParameterValue ("reverbDamping");
+        reverbOnParam = getTrackedParameter ("reverbOn", reverbGroup);
+        reverbDryWetParam = getTrackedParameter ("reverbDryWet", reverbGroup);
+        reverbRoomSizeParam = getTrackedParameter ("reverbRoomSize", reverbGroup);
+        reverbWidthParam = getTrackedParameter ("reverbWidth", reverbGroup);
+        reverbDampingParam = getTrackedParameter ("reverbDamping", reverbGroup);
+        // unison
+        unisonVoicesParam = getTrackedParameter ("unisonVoices", unisonGroup);
+        unisonDetuneParam = getTrackedParameter ("unisonDetune", unisonGroup);
+        unisonSpreadParam = getTrackedParameter ("unisonSpread", unisonGroup);
+        // voice
+        voiceEndThresholdParam = getTrackedParameter ("voiceEndThreshold", voiceGroup);
+        voicePanModeParam = getTrackedParameter ("voicePanMode", voiceGroup);
+        voicePanAmountParam = getTrackedParameter ("voicePanAmount", voiceGroup);
+        voiceCpuBudgetParam = getTrackedParameter ("voiceCpuBudget", voiceGroup);
+        qualityParam = getTrackedParameter ("quality", voiceGroup);
+        pipelinedParam = getTrackedParameter ("pipelined", voiceGroup);
+        // parameters list in a fixed order for the binary state
+        for (auto* p : audioProcessor.getParameters())
+        {
+            if (auto* rangedParam = dynamic_cast<juce::RangedAudioParameter*> (p))
+            {
+                parameterList.push_back (rangedParam);
+                rawValueList.push_back (apvts.getRawParameterValue (rangedParam->getParameterID()));
+            }
+        }
+        calculateLayoutHashes();
+    }
+
+    /// destructor which removes parameter listeners
+    ~Parameters()
+    {
+        for (auto& listener : groupListeners)
+            apvts.removeParameterListener (listener->parameterID, listener.get());
+    }
+
+    //==========================================================================
+    // change tracking: each parameter group has a version which is incremented
+    // whenever any of its parameters change, so derived values can be refreshed
+    // only when their inputs actually change
+
+    static constexpr int algorithmGroup = 0;                  // algorithm parameter group
+    static constexpr int filterGroup = 1;                     // filter parameters group
+    static constexpr int pitchEnvGroup = 2;                   // pitch envelope parameters group
+    static constexpr int delayGroup = 3;                      // delay parameters group
+    static constexpr int reverbGroup = 4;                     // reverb parameters group
+    static constexpr int unisonGroup = 5;                     // unison parameters group
+    static constexpr int voiceGroup = 6;                      // voice parameters group
+    static constexpr int numFixedGroups = 7;                  // number of groups before operators and LFOs groups
+    static constexpr juce::uint32 unseenVersion = 0xffffffff; // initial value for a seen version (forces the first update)
+
+    //==========================================================================
+    // render quality tiers: DSP implementations in operators, filters, LFOs
+    // and reverb are swapped together
+
+    static constexpr int draftQuality = 0;                    // control-rate modulation and the cheapest DSP
+    static constexpr int realtimeQuality = 1;                 // default DSP for live playing
+    static constexpr int offlineQuality = 2;                  // the most accurate DSP for rendering
+    static constexpr int draftControlInterval = 8;            // samples between filter and LFO updates in draft quality
+
+    /// get number of algorithms for a number of operators (see Algorithm.h)
+    /// @param int, number of operators (4, 6 or 8)
+    /// @return int, number of algorithms
+    static constexpr int getNumAlgorithms (int _numOperators)
+    {
+        return _numOperators > 4 ? 32 : 11;
+    }
+
+    /// get parameters group for an operator
+    /// @param int, operator index
+    /// @return int, parameters group
+    int getOperatorGroup (int _opIdx) const
+    {
+        return numFixedGroups + _opIdx;
+    }
+
+    /// get parameters group for an LFO
+    /// @param int, LFO index
+    /// @return int, parameters group
+    int getLFOGroup (int _lfoIdx) const
+    {
+        return numFixedGroups + numOperators + _lfoIdx;
+    }
+
+    /// get number of parameter groups
+    /// @return int, number of groups
+    int getNumGroups() const
+    {
+        return numFixedGroups + numOperators + numLFOs;
+    }
+
+    /// check if any parameter in a group has changed since the last check
+    /// @param int, parameters group
+    /// @param juce::uint32&, last seen version of the group (is updated when the group has changed)
+    /// @return bool, true if the group has changed
+    bool hasChanged (int _group, juce::uint32& seenVersion) const
+    {
+        juce::uint32 version = groupVersions[_group].load();
+        if (version == seenVersion)
+            return false;
+        seenVersion = version;
+        return true;
+    }
+
+    /// get current version of a parameter group
+    /// @param int, parameters group
+    /// @return juce::uint32, version (is incremented whenever any parameter of the group changes)
+    juce::uint32 getVersion (int _group) const
+    {
+        return groupVersions[_group].load();
+    }
+
+    /// get parameters of a group (e.g. for an editor section)
+    /// @param int, parameters group
+    /// @return const std::vector<juce::RangedAudioParameter*>&, parameters in the order they are tracked
+    const std::vector<juce::RangedAudioParameter*>& getGroupParameters (int _group) const
+    {
+        return groupParameters[size_t (_group)];
+    }
+
+    /// mark all parameter groups as changed (used when values are set bypassing the listeners)
+    void markAllChanged()
+    {
+        for (int i = 0; i < getNumGroups(); i++)
+            groupVersions[i].fetch_add (1);
+    }
+
+    /// write binary state: a header followed by normalised parameter values in the layout order
+    /// (values are written straight to the destination, so concurrent calls don't share a buffer)
+    /// @param juce::MemoryBlock&, destination memory block
+    void getBinaryState (juce::MemoryBlock& destData) const
+    {
+        StateHeader header { stateMagic, stateVersion, layoutHash, juce::uint32 (parameterList.size()) };
+        destData.setSize (size_t (getBinaryStateSize (int (parameterList.size()))));
+        auto* dest = static_cast<char*> (destData.getData());
+        std::memcpy (dest, &header, sizeof (StateHeader));
+        for (size_t i = 0; i < parameterList.size(); i++)
+        {
+            float value = parameterList[i]->getValue();
+            std::memcpy (dest + sizeof (StateHeader) + i * sizeof (float), &value, sizeof (float));
+        }
+    }
+
+    /// get size of a binary state
+    /// @param int, number of parameter values in the state
+    /// @return int, size in bytes
+    static int getBinaryStateSize (int numValues)
+    {
+        return int (sizeof (StateHeader) + size_t (numValues) * sizeof (float));
+    }
+
+    /// get number of parameters in the layout
+    /// @return int, number of parameters
+    int getNumParameters() const
+    {
+        return int (parameterList.size());
+    }
+
+    /// copy raw (denormalised) parameter values in the layout order
+    /// @param float*, destination array (should have getNumParameters() elements)
+    void getRawValues (float* values) const
+    {
+        for (size_t i = 0; i < rawValueList.size(); i++)
+            values[i] = rawValueList[i]->load();
+    }
+
+    /// get raw (denormalised) default parameter values in the layout order
+    /// @param float*, destination array (should have getNumParameters() elements)
+    void getDefaultRawValues (float* values) const
+    {
+        for (size_t i = 0; i < parameterList.size(); i++)
+            values[i] = parameterList[i]->convertFrom0to1 (parameterList[i]->getDefaultValue());
+    }
+
+    /// set raw (denormalised) parameter values in the layout order;
+    /// doesn't allocate or lock so it can be used on the audio thread,
+    /// the host is updated later by calling notifyHostOfRawValues()
+    /// @param const float*, source array (should have getNumParameters() elements)
+    void setRawValues (const float* values)
+    {
+        for (size_t i = 0; i < rawValueList.size(); i++)
+            rawValueList[i]->store (values[i]);
+        markAllChanged();
+    }
+
+    /// set raw (denormalised) parameter values in the layout order and notify the host (message thread only)
+    /// @param const float*, source array (should have getNumParameters() elements)
+    void setRawValuesNotifyingHost (const float* values)
+    {
+        for (size_t i = 0; i < parameterList.size(); i++)
+            parameterList[i]->setValueNotifyingHost (parameterList[i]->convertTo0to1 (values[i]));
+    }
+
+    /// notify the host of raw parameter values which were set by setRawValues() (message thread only)
+    void notifyHostOfRawValues()
+    {
+        for (size_t i = 0; i < parameterList.size(); i++)
+            parameterList[i]->setValueNotifyingHost (parameterList[i]->convertTo0to1 (rawValueList[i]->load()));
+    }
+
+    /// read binary state written by getBinaryState();
+    /// states saved with an older layout are accepted if the current layout only appends parameters to it,
+    /// in which case appended parameters are set to their default values
+    /// @param const void*, state data
+    /// @param int, state size in bytes (data after parameter values is ignored)
+    /// @return int, number of parameter values read (0 if data isn't a binary state for the current parameter layout,
+    ///         e.g. a state saved by a build with another layout, which the caller reads from XML instead)
+    int setBinaryState (const void* data, int sizeInBytes)
+    {
+        if (data == nullptr || sizeInBytes < int (sizeof (StateHeader)))
+            return 0;
+        StateHeader header;
+        std::memcpy (&header, data, sizeof (StateHeader));
+        if (header.magic != stateMagic)
+            return 0;
+        // check that the state was saved with the same parameter layout or its prefix
+        if (header.version != stateVersion || header.numParameters == 0 || header.numParameters > parameterList.size()
+            || header.layoutHash != layoutHashes[header.numParameters] || sizeInBytes < getBinaryStateSize (int (header.numParameters)))
+            return 0;
+        // values are read one at a time (the data may be unaligned), so concurrent calls don't share a buffer
+        auto* values = static_cast<const char*> (data) + sizeof (StateHeader);
+        for (size_t i = 0; i < parameterList.size(); i++)
+        {
+            float value = parameterList[i]->getDefaultValue();
+            if (i < header.numParameters)
+                std::memcpy (&value, values + i * sizeof (float), sizeof (float));
+            parameterList[i]->setValueNotifyingHost (value);
+        }
+        return int (header.numParameters);
     }
 private:
+    /// listener which increments version of a parameter group
+    struct GroupListener : public juce::AudioProcessorValueTreeState::Listener
+    {
+        GroupListener (const juce::String& _parameterID, std::atomic<juce::uint32>* _version) :
+            parameterID (_parameterID), version (_version)
+        {
+        }
+
+        void parameterChanged (const juce::String&, float) override
+        {
+            version->fetch_add (1);
+        }
+
+        juce::String parameterID;          // parameter ID
+        std::atomic<juce::uint32>* version; // version of the parameter group
+    };
+
+    std::unique_ptr<std::atomic<juce::uint32>[]> groupVersions;            // versions of parameter groups
+    std::vector<std::unique_ptr<GroupListener>> groupListeners;            // listeners for all parameters
+    std::vector<std::vector<juce::RangedAudioParameter*>> groupParameters; // parameters of each group
+
+    /// get raw parameter value and track its changes in a group
+    /// @param const juce::String&, parameter ID
+    /// @param int, parameters group
+    /// @return std::atomic<float>*, raw parameter value
+    std::atomic<float>* getTrackedParameter (const juce::String& _parameterID, int _group)
+    {
+        groupListeners.push_back (std::make_unique<GroupListener> (_parameterID, &groupVersions[_group]));
+        apvts.addParameterListener (_parameterID, groupListeners.back().get());
+        groupParameters[size_t (_group)].push_back (apvts.getParameter (_parameterID));
+        return apvts.getRawParameterValue (_parameterID);
+    }
+
+    /// binary state header
+    struct StateHeader
+    {
+        juce::uint32 magic;         // binary state identifier
+        juce::uint32 version;       // binary state version
+        juce::uint32 layoutHash;    // hash of parameters IDs in the layout order
+        juce::uint32 numParameters; // number of parameter values after the header
+    };
+
+    static constexpr juce::uint32 stateMagic = 0x42534d50; // "PMSB" in little-endian byte order
+    static constexpr juce::uint32 stateVersion = 1;        // binary state version
+
+    std::vector<juce::RangedAudioParameter*> parameterList; // parameters in the layout order
+    std::vector<std::atomic<float>*> rawValueList;          // raw parameter values in the layout order
+    std::vector<juce::uint32> layoutHashes;                 // hashes of layout prefixes (n-th element is a hash of the first n parameters)
+    juce::uint32 layoutHash = 0;                            // hash of parameters layout
+
+    /// calculate FNV-1a hashes of parameters IDs in the layout order for every layout prefix
+    void calculateLayoutHashes()
+    {
+        juce::uint32 hash = 2166136261u;
+        layoutHashes.assign (1, hash);
+        for (auto* p : parameterList)
+        {
+            juce::String id = p->getParameterID();
+            const char* str = id.toRawUTF8();
+            for (size_t i = 0; i <= std::strlen (str); i++) // terminating zero separates IDs
+            {
+                hash ^= juce::uint8 (str[i]);
+                hash *= 16777619u;
+            }
+            layoutHashes.push_back (hash);
+        }
+        layoutHash = hash;
+    }
+
     /// get nth letter from alphabet
     /// @param int, letter's number in alphabet
     /// @return char, alphaber letter
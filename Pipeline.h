@@ -0,0 +1,297 @@
+#ifndef PIPELINE_H
+#define PIPELINE_H
+
+#include <JuceHeader.h>      // for juce::Thread, juce::WaitableEvent and juce::AudioSampleBuffer
+#include <atomic>            // for std::atomic
+#include <functional>        // for std::function
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+ #include <immintrin.h>      // for _mm_pause()
+#endif
+#include "RealtimeChecker.h" // for flagging the worker thread as real-time
+
+/// Pipeline class.
+/// Splits processing of a block into two stages which run in parallel on different blocks:
+/// while the audio thread renders the first stage (the synthesizer) of the current block,
+/// a worker thread processes the second stage (the effects) of the previous block. The
+/// output is delayed by the maximum block size, which is the latency reported to the host.
+/// Processed blocks pass through a delay line, so blocks of any size up to the maximum
+/// keep the latency constant. If the worker hasn't picked the second stage up by the time
+/// the first stage is rendered, the audio thread processes it itself. If the worker has
+/// already started it, the audio thread spins until the worker finishes the block, but
+/// only for a part of the block duration: a worker which is later than that (e.g. it was
+/// preempted) loses its block, which is output as silence, and the audio thread processes
+/// the second stage inline for a while. The worker runs only while pipelined processing
+/// is switched on. It is a real-time thread and joins the host's audio workgroup.
+class Pipeline : private juce::Thread
+{
+public:
+    /// constructor which sets the second stage
+    /// @param std::function<void (juce::AudioSampleBuffer&, int)>, second stage (processes a buffer with a number of samples)
+    Pipeline (std::function<void (juce::AudioSampleBuffer&, int)> _secondStage) :
+        juce::Thread ("PMSynth pipeline"), secondStage (std::move (_secondStage))
+    {
+    }
+
+    /// destructor which stops the worker thread
+    ~Pipeline() override
+    {
+        stopWorker();
+    }
+
+    /// allocate buffers (must not be called while a block is processed)
+    /// @param int, number of channels
+    /// @param int, maximum block size [samples]
+    /// @param double, sample rate [Hz]
+    void prepare (int _numChannels, int _maxBlockSize, double _sampleRate)
+    {
+        numChannels = _numChannels;
+        maxBlockSize = juce::jmax (1, _maxBlockSize);
+        sampleRate = _sampleRate;
+        for (auto& buffer : pendingBuffers)
+            buffer.setSize (numChannels, maxBlockSize);
+        delayBuffer.setSize (numChannels, maxBlockSize);
+        spinTicksPerSample = maxSpinFraction * double (juce::Time::getHighResolutionTicksPerSecond()) / sampleRate;
+        numFallbackBlocks = juce::jmax (1, int (fallbackSeconds * sampleRate) / maxBlockSize);
+        reset();
+    }
+
+    /// start the worker thread as a real-time thread with the period of the maximum block size
+    /// (message thread, when pipelined processing is switched on)
+    void startWorker()
+    {
+        const juce::ScopedLock lock (workerLock);
+        if (isThreadRunning())
+            return;
+        auto options = juce::Thread::RealtimeOptions{}.withPeriodMs (1000.0 * maxBlockSize / sampleRate);
+        // without the rights for real-time scheduling the worker gets the highest normal priority
+        if (startRealtimeThread (options) == false && isThreadRunning() == false)
+            startThread (juce::Thread::Priority::highest);
+    }
+
+    /// stop the worker thread (message thread, when pipelined processing is switched off;
+    /// the audio thread processes blocks which are handed over later itself)
+    void stopWorker()
+    {
+        const juce::ScopedLock lock (workerLock);
+        signalThreadShouldExit();
+        jobEvent.signal();
+        stopThread (1000);
+    }
+
+   #if JUCE_VERSION >= 0x70006
+    /// set the audio workgroup of the host's audio threads, which the worker joins
+    /// (not called on the audio thread; a running worker is restarted to join the new workgroup)
+    /// @param const juce::AudioWorkgroup&, workgroup
+    void setWorkgroup (const juce::AudioWorkgroup& _workgroup)
+    {
+        const juce::ScopedLock lock (workerLock);
+        bool isRunning = isThreadRunning();
+        if (isRunning)
+            stopWorker();
+        workgroup = _workgroup;
+        if (isRunning)
+            startWorker();
+    }
+   #endif
+
+    /// get latency of pipelined processing
+    /// @return int, latency [samples]
+    int getLatency() const
+    {
+        return maxBlockSize;
+    }
+
+    //==========================================================================
+    // audio thread
+
+    /// clear the pipeline (e.g. when pipelined processing is switched on)
+    void reset()
+    {
+        delayBuffer.clear();
+        numPendingSamples = 0;
+        delayPosition = 0;
+    }
+
+    /// check if the second stage can be processed, i.e. the worker isn't processing a block
+    /// which was dropped after a timeout (the second stage must not run on two threads)
+    /// @return bool, true if the second stage is free
+    bool isSecondStageFree()
+    {
+        if (isJobAbandoned && jobState.load (std::memory_order_acquire) == doneJob)
+        {
+            isJobAbandoned = false;
+            jobState.store (noJob, std::memory_order_relaxed);
+        }
+        return isJobAbandoned == false;
+    }
+
+    /// check if a buffer can be processed by the pipeline
+    /// @param const juce::AudioSampleBuffer&, buffer
+    /// @return bool, true if the buffer fits the prepared number of channels and block size
+    bool canProcess (const juce::AudioSampleBuffer& _buffer) const
+    {
+        return _buffer.getNumChannels() == numChannels && _buffer.getNumSamples() <= maxBlockSize;
+    }
+
+    /// process a block: render its first stage into the buffer while the worker processes the second
+    /// stage of the previous block, and output the delayed result of the second stage
+    /// @param juce::AudioSampleBuffer&, buffer
+    /// @param Render&&, first stage (renders into the buffer)
+    template <typename Render>
+    void process (juce::AudioSampleBuffer& _buffer, Render&& _renderFirstStage)
+    {
+        jassert (canProcess (_buffer)); // check if the pipeline is prepared for the buffer
+        int numSamples = _buffer.getNumSamples();
+        bool isSecondStageRun = numPendingSamples > 0 && isSecondStageFree();
+        // hand the previous block over to the worker (unless the second stage runs inline after a timeout)
+        bool isPosted = isSecondStageRun && numInlineBlocks == 0;
+        if (isPosted)
+        {
+            jobIndex = pendingIndex;
+            jobSamples = numPendingSamples;
+            jobState.store (postedJob, std::memory_order_release);
+            jobEvent.signal();
+        }
+        _renderFirstStage (_buffer);
+        // process the previous block here if the worker hasn't started it, otherwise wait for the worker
+        if (isPosted)
+        {
+            int expected = postedJob;
+            if (jobState.compare_exchange_strong (expected, takenJob, std::memory_order_acquire))
+                processJob();
+            if (waitForWorker (numPendingSamples))
+                jobState.store (noJob, std::memory_order_relaxed);
+            else
+            {
+                // the worker is late: its block is dropped and blocks are processed inline for a while
+                isJobAbandoned = true;
+                isSecondStageRun = false;
+                numInlineBlocks = numFallbackBlocks;
+            }
+        }
+        else if (isSecondStageRun)
+        {
+            secondStage (pendingBuffers[pendingIndex], numPendingSamples);
+            numInlineBlocks = juce::jmax (0, numInlineBlocks - 1);
+        }
+        // the worker may still use the buffer of a dropped block
+        if (isJobAbandoned)
+            pendingIndex = 1 - jobIndex;
+        // pass the processed block (or silence for a dropped one) through the delay line, then keep the current block for the worker
+        for (int chan = 0; chan < numChannels; chan++)
+        {
+            float* delayLine = delayBuffer.getWritePointer (chan);
+            const float* processed = pendingBuffers[pendingIndex].getReadPointer (chan);
+            float* samples = _buffer.getWritePointer (chan);
+            int writePosition = delayPosition;
+            for (int n = 0; n < numPendingSamples; n++)
+            {
+                delayLine[writePosition] = isSecondStageRun ? processed[n] : 0.0f;
+                writePosition = writePosition + 1 == maxBlockSize ? 0 : writePosition + 1;
+            }
+            pendingBuffers[pendingIndex].copyFrom (chan, 0, samples, numSamples);
+            // the delay line holds exactly the latency, so the oldest samples start at the write position
+            int readPosition = writePosition;
+            for (int n = 0; n < numSamples; n++)
+            {
+                samples[n] = delayLine[readPosition];
+                readPosition = readPosition + 1 == maxBlockSize ? 0 : readPosition + 1;
+            }
+        }
+        delayPosition = (delayPosition + numPendingSamples) % maxBlockSize;
+        numPendingSamples = numSamples;
+    }
+
+private:
+    // job states
+    static constexpr int noJob = 0;     // no block is handed over
+    static constexpr int postedJob = 1; // a block waits for processing
+    static constexpr int takenJob = 2;  // a block is being processed
+    static constexpr int doneJob = 3;   // a block is processed
+
+    static constexpr double maxSpinFraction = 0.5;  // longest wait for the worker as a fraction of the block duration
+    static constexpr double fallbackSeconds = 1.0;  // time the second stage runs inline after the worker was late [sec]
+    static constexpr int numSpinsPerClockCheck = 64; // number of spins between checks of the wait time
+
+    std::function<void (juce::AudioSampleBuffer&, int)> secondStage; // second stage (effects)
+    int numChannels = 0;                                             // number of channels
+    int maxBlockSize = 1;                                            // maximum block size (the latency) [samples]
+    double sampleRate = 44100.0;                                     // sample rate [Hz]
+    double spinTicksPerSample = 0.0;                                 // longest wait for the worker per sample [high resolution ticks]
+    juce::AudioSampleBuffer pendingBuffers[2];                       // blocks handed over to the second stage (two for a dropped block)
+    int pendingIndex = 0;                                            // index of the buffer with the pending block
+    int numPendingSamples = 0;                                       // number of samples in the pending block
+    juce::AudioSampleBuffer delayBuffer;                             // delay line of the processed blocks
+    int delayPosition = 0;                                           // write position in the delay line
+    int numFallbackBlocks = 1;                                       // number of blocks processed inline after the worker was late
+    int numInlineBlocks = 0;                                         // number of blocks left to process inline
+    bool isJobAbandoned = false;                                     // flag for a dropped block which the worker still processes
+    int jobIndex = 0;                                                // index of the buffer with the handed over block
+    int jobSamples = 0;                                              // number of samples in the handed over block
+    std::atomic<int> jobState { noJob };                             // state of the handed over block
+    juce::WaitableEvent jobEvent;                                    // event which wakes the worker up
+    juce::CriticalSection workerLock;                                // lock for starting and stopping the worker (message thread)
+   #if JUCE_VERSION >= 0x70006
+    juce::AudioWorkgroup workgroup;                                  // audio workgroup of the host (the worker joins it)
+   #endif
+
+    /// hint the CPU that the thread spins (frees resources for a sibling hyper-thread and
+    /// saves power; unlike yielding it doesn't call the operating system)
+    static void pause()
+    {
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+        _mm_pause();
+#elif defined(__aarch64__) || defined(__arm__)
+        __asm__ __volatile__ ("yield");
+#elif defined(_M_ARM64)
+        __yield();
+#endif
+    }
+
+    /// process the handed over block with the second stage
+    void processJob()
+    {
+        secondStage (pendingBuffers[jobIndex], jobSamples);
+        jobState.store (doneJob, std::memory_order_release);
+    }
+
+    /// spin until the worker finishes the handed over block, for a part of the block duration
+    /// @param int, number of samples in the block
+    /// @return bool, true if the block is processed
+    bool waitForWorker (int _numSamples)
+    {
+        juce::int64 deadline = juce::Time::getHighResolutionTicks() + juce::int64 (spinTicksPerSample * _numSamples);
+        for (int i = 1; jobState.load (std::memory_order_acquire) != doneJob; i++)
+        {
+            if (i % numSpinsPerClockCheck == 0 && juce::Time::getHighResolutionTicks() > deadline)
+                return false;
+            pause();
+        }
+        return true;
+    }
+
+    /// worker thread loop
+    void run() override
+    {
+        juce::ScopedNoDenormals noDenormals;
+       #if JUCE_VERSION >= 0x70006
+        // the host schedules the worker together with its audio threads (the token leaves the workgroup)
+        juce::WorkgroupToken workgroupToken;
+        if (workgroup)
+            workgroup.join (workgroupToken);
+       #endif
+        while (threadShouldExit() == false)
+        {
+            jobEvent.wait (100);
+            int expected = postedJob;
+            if (jobState.compare_exchange_strong (expected, takenJob, std::memory_order_acquire))
+            {
+                // the audio thread may be waiting for the job
+                RealtimeChecker::ScopedRealtime realtimeScope;
+                processJob();
+            }
+        }
+    }
+};
+
+#endif // PIPELINE_H
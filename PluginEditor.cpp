@@ -11,15 +11,106 @@
 
 //==============================================================================
 PMSynthAudioProcessorEditor::PMSynthAudioProcessorEditor (PMSynthAudioProcessor& p)
-    : AudioProcessorEditor (&p), audioProcessor (p)
+    : AudioProcessorEditor (&p), audioProcessor (p),
+      visualizer (p.getVisualizerFifo(), p)
 {
-    // Make sure that before the constructor has finished, you've set the
-    // editor's size to whatever you need it to be.
-    setSize (400, 300);
+    Parameters& param = audioProcessor.getParameterSet();
+    // global settings, operators, modulation and effects
+    addRow ({ { "Algorithm", Parameters::algorithmGroup }, { "Pitch envelope", Parameters::pitchEnvGroup },
+              { "Unison", Parameters::unisonGroup }, { "Voice", Parameters::voiceGroup } });
+    std::vector<std::pair<juce::String, int>> operators;
+    for (int i = 0; i < param.numOperators; i++)
+    {
+        operators.push_back ({ "Operator " + juce::String::charToString (juce::juce_wchar ('A' + i)), param.getOperatorGroup (i) });
+        if (int (operators.size()) == maxRowSections || i == param.numOperators - 1)
+        {
+            addRow (operators);
+            operators.clear();
+        }
+    }
+    std::vector<std::pair<juce::String, int>> modulation { { "Filter", Parameters::filterGroup } };
+    for (int i = 0; i < param.numLFOs; i++)
+        modulation.push_back ({ "LFO " + juce::String (i + 1), param.getLFOGroup (i) });
+    addRow (modulation);
+    addRow ({ { "Delay", Parameters::delayGroup }, { "Reverb", Parameters::reverbGroup } });
+    addAndMakeVisible (visualizer);
+    storeButton.onClick = [this] { audioProcessor.storeProgram (audioProcessor.getCurrentProgram()); };
+    addAndMakeVisible (storeButton);
+    recordButton.onClick = [this] { toggleRecording(); };
+    addAndMakeVisible (recordButton);
+    addAndMakeVisible (recordStatus);
+    updateRecordButton();
+    // editor size fits all rows, the button bar and the visualizer
+    int height = buttonBarHeight + visualizerHeight;
+    for (auto& row : rows)
+    {
+        int rowHeight = 0;
+        for (auto& section : row)
+            rowHeight = juce::jmax (rowHeight, section->getPreferredHeight());
+        height += rowHeight;
+    }
+    setSize (sectionWidth * maxRowSections, height);
+    startTimerHz (frameRate);
 }
 
 PMSynthAudioProcessorEditor::~PMSynthAudioProcessorEditor()
 {
+    stopTimer();
+}
+
+void PMSynthAudioProcessorEditor::addRow (const std::vector<std::pair<juce::String, int>>& sections)
+{
+    rows.emplace_back();
+    for (auto& section : sections)
+    {
+        rows.back().push_back (std::make_unique<ParameterSection> (section.first, &audioProcessor.getParameterSet(), section.second));
+        addAndMakeVisible (rows.back().back().get());
+    }
+}
+
+void PMSynthAudioProcessorEditor::toggleRecording()
+{
+    if (audioProcessor.getRecorder().isRecording())
+    {
+        audioProcessor.stopRecording();
+        updateRecordButton();
+        return;
+    }
+    // the chooser calls back on the message thread; it is destroyed with the editor, so the callback can't outlive it
+    fileChooser = std::make_unique<juce::FileChooser> ("Record the output to a WAV or FLAC file",
+                                                       juce::File::getSpecialLocation (juce::File::userMusicDirectory).getChildFile ("PMSynth.wav"),
+                                                       "*.wav;*.flac");
+    int flags = juce::FileBrowserComponent::saveMode | juce::FileBrowserComponent::canSelectFiles
+              | juce::FileBrowserComponent::warnAboutOverwriting;
+    fileChooser->launchAsync (flags, [this] (const juce::FileChooser& chooser)
+    {
+        juce::File file = chooser.getResult();
+        if (file == juce::File())
+            return;
+        juce::String error = audioProcessor.startRecording (file);
+        recordStatus.setText (error.isEmpty() ? "Recording to " + file.getFileName() : "Recording failed: " + error, juce::dontSendNotification);
+        updateRecordButton();
+    });
+}
+
+void PMSynthAudioProcessorEditor::updateRecordButton()
+{
+    bool isRecording = audioProcessor.getRecorder().isRecording();
+    if (recordButton.getToggleState() == isRecording)
+        return;
+    if (isRecording == false && recordButton.getToggleState())
+        recordStatus.setText (audioProcessor.getRecorder().getStatus(), juce::dontSendNotification);
+    recordButton.setToggleState (isRecording, juce::dontSendNotification);
+    recordButton.setButtonText (isRecording ? "Stop" : "Record");
+}
+
+void PMSynthAudioProcessorEditor::timerCallback()
+{
+    updateRecordButton();
+    // parameter changes since the last frame are coalesced into one repaint per section
+    for (auto& row : rows)
+        for (auto& section : row)
+            section->update();
 }
 
 //==============================================================================
@@ -27,14 +118,25 @@ void PMSynthAudioProcessorEditor::paint (juce::Graphics& g)
 {
     // (Our component is opaque, so we must completely fill the background with a solid colour)
     g.fillAll (getLookAndFeel().findColour (juce::ResizableWindow::backgroundColourId));
-
-    g.setColour (juce::Colours::white);
-    g.setFont (15.0f);
-    g.drawFittedText ("Hello World!", getLocalBounds(), juce::Justification::centred, 1);
 }
 
 void PMSynthAudioProcessorEditor::resized()
 {
-    // This is generally where you'll want to lay out the positions of any
-    // subcomponents in your editor..
+    // sections in a row share its width, rows are as high as their highest section
+    auto area = getLocalBounds();
+    for (auto& row : rows)
+    {
+        int rowHeight = 0;
+        for (auto& section : row)
+            rowHeight = juce::jmax (rowHeight, section->getPreferredHeight());
+        auto rowArea = area.removeFromTop (rowHeight);
+        int width = rowArea.getWidth() / int (row.size());
+        for (auto& section : row)
+            section->setBounds (section == row.back() ? rowArea : rowArea.removeFromLeft (width));
+    }
+    auto buttonArea = area.removeFromTop (buttonBarHeight).reduced (2);
+    storeButton.setBounds (buttonArea.removeFromLeft (buttonWidth));
+    recordButton.setBounds (buttonArea.removeFromLeft (buttonWidth));
+    recordStatus.setBounds (buttonArea);
+    visualizer.setBounds (area);
 }
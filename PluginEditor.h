@@ -10,11 +10,18 @@
 
 #include <JuceHeader.h>
 #include "PluginProcessor.h"
+#include "ParameterSection.h"
+#include "Visualizer.h"
 
 //==============================================================================
-/**
+/** Compact editor with one section per parameter group (operators, filter, LFOs,
+    effects and global settings). Sections are repainted from a timer at a capped
+    frame rate and only when their parameters have changed. A bar above the visualizer
+    stores the current sound to the current program and records the output to a file
+    chosen by the user.
 */
-class PMSynthAudioProcessorEditor  : public juce::AudioProcessorEditor
+class PMSynthAudioProcessorEditor  : public juce::AudioProcessorEditor,
+                                     private juce::Timer
 {
 public:
     PMSynthAudioProcessorEditor (PMSynthAudioProcessor&);
@@ -29,5 +36,32 @@ private:
     // access the processor object that created it.
     PMSynthAudioProcessor& audioProcessor;
 
+    static constexpr int frameRate = 30;         // maximum number of section repaints per second
+    static constexpr int sectionWidth = 200;     // width of a section [px]
+    static constexpr int maxRowSections = 4;     // maximum number of sections in a row
+    static constexpr int visualizerHeight = 160; // height of the oscilloscope and spectrum [px]
+    static constexpr int buttonBarHeight = 28;   // height of the store and record buttons and the recording status [px]
+    static constexpr int buttonWidth = 80;       // width of the store and record buttons [px]
+
+    std::vector<std::vector<std::unique_ptr<ParameterSection>>> rows; // sections in rows
+    Visualizer visualizer;                                            // oscilloscope and spectrum of the output
+    juce::TextButton storeButton { "Store" };                         // stores the current sound to the current program
+    juce::TextButton recordButton { "Record" };                       // starts and stops recording of the output
+    juce::Label recordStatus;                                         // recorded file or status of the last recording
+    std::unique_ptr<juce::FileChooser> fileChooser;                   // chooser of the recorded file (kept while it's open)
+
+    /// add a row of sections
+    /// @param std::vector<std::pair<juce::String, int>>, titles and parameter groups of the sections
+    void addRow (const std::vector<std::pair<juce::String, int>>& sections);
+
+    /// stop recording or ask for a file and start recording to it
+    void toggleRecording();
+
+    /// show the recording state (recording also stops when the sample rate changes)
+    void updateRecordButton();
+
+    /// repaint sections which have changed
+    void timerCallback() override;
+
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (PMSynthAudioProcessorEditor)
 };
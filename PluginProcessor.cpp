@@ -22,19 +22,28 @@ PMSynthAudioProcessor::PMSynthAudioProcessor()
                        ),
 #endif
     param (*this, numOperators, numLFOs),
+    presetBank (&param),
+    synth (&param, &presetBank),
     delay (&param),
-    reverb (&param)
+    reverb (&param),
+    pipeline ([this] (juce::AudioSampleBuffer& buffer, int numSamples) { processEffects (buffer, numSamples); })
 {
+#if ! PMSYNTH_FAST_MATH
+    // oscillators read the sine wavetable only when fast math is switched off
+    sineTable.prepare (0.0);
+#endif
     // add synth voices
     for (int i = 0; i < numVoices; i++)
     {
-        synth.addVoice (new PMSynthVoice (&param));
+        synth.addVoice (new PMSynthVoice<numOperators> (&param, synth.getSharedLFOs(), synth.getVoiceTemplates()));
     }
     synth.addSound (new PMSynthSound());
+    startTimerHz (10);
 }
 
 PMSynthAudioProcessor::~PMSynthAudioProcessor()
 {
+    stopTimer();
 }
 
 //==============================================================================
@@ -72,31 +81,39 @@ bool PMSynthAudioProcessor::isMidiEffect() const
 
 double PMSynthAudioProcessor::getTailLengthSeconds() const
 {
-    return 0.0;
+    // delay output is fed to reverb, so their tails add up
+    return delay.getTailLengthSeconds() + reverb.getTailLengthSeconds();
 }
 
 int PMSynthAudioProcessor::getNumPrograms()
 {
-    return 1;   // NB: some hosts don't cope very well if you tell them there are 0 programs,
-                // so this should be at least 1, even if you're not really implementing programs.
+    return PresetBank::numPresets;
 }
 
 int PMSynthAudioProcessor::getCurrentProgram()
 {
-    return 0;
+    return presetBank.getCurrentPreset();
 }
 
 void PMSynthAudioProcessor::setCurrentProgram (int index)
 {
+    presetBank.selectPreset (index);
 }
 
 const juce::String PMSynthAudioProcessor::getProgramName (int index)
 {
-    return {};
+    return presetBank.getPresetName (index);
 }
 
 void PMSynthAudioProcessor::changeProgramName (int index, const juce::String& newName)
 {
+    // hosts rename programs without asking to store the current sound (see storeProgram())
+    presetBank.renamePreset (index, newName);
+}
+
+void PMSynthAudioProcessor::storeProgram (int index)
+{
+    presetBank.storePreset (index, presetBank.getPresetName (index));
 }
 
 //==============================================================================
@@ -106,14 +123,55 @@ void PMSynthAudioProcessor::prepareToPlay (double sampleRate, int samplesPerBloc
     synth.setCurrentPlaybackSampleRate (sampleRate);
     delay.prepareToPlay (sampleRate);
     reverb.prepareToPlay (sampleRate);
+    // select DSP kernels for the instruction set of the CPU
+    int simdTier = SimdDispatch::selectTier();
+    synth.setSimdTier (simdTier);
+    delay.setSimdTier (simdTier);
+    // pipelined processing is prepared for the maximum block size, which is its latency
+    pipeline.prepare (getTotalNumOutputChannels(), samplesPerBlock, sampleRate);
+    isPipelined = *param.pipelinedParam == true && isNonRealtime() == false;
+    // the worker thread runs only in pipelined mode
+    if (isPipelined)
+        pipeline.startWorker();
+    else
+        pipeline.stopWorker();
+    setLatencySamples (isPipelined ? pipeline.getLatency() : 0);
+    isPipelinedMode.store (isPipelined);
+    // a recording can't change its sample rate
+    if (recorder.isRecording() && recorder.getSampleRate() != sampleRate)
+        recorder.stop();
 }
 
 void PMSynthAudioProcessor::releaseResources()
 {
-    // When playback stops, you can use this as an opportunity to free up any
-    // spare memory, etc.
+    // stop the pipeline worker and free effects memory
+    pipeline.stopWorker();
+    delay.releaseResources();
+    reverb.releaseResources();
 }
 
+void PMSynthAudioProcessor::reset()
+{
+    // stop all voices without tails (effects are cleared in prepareToPlay())
+    synth.allNotesOff (0, false);
+}
+
+void PMSynthAudioProcessor::setNonRealtime (bool isNonRealtime) noexcept
+{
+    AudioProcessor::setNonRealtime (isNonRealtime);
+    // offline rendering can wait for effects memory instead of rendering them dry
+    delay.setNonRealtime (isNonRealtime);
+    reverb.setNonRealtime (isNonRealtime);
+}
+
+#if JUCE_VERSION >= 0x70006
+void PMSynthAudioProcessor::audioWorkgroupContextChanged (const juce::AudioWorkgroup& workgroup)
+{
+    // the pipeline worker is scheduled together with the host's audio threads
+    pipeline.setWorkgroup (workgroup);
+}
+#endif
+
 #ifndef JucePlugin_PreferredChannelConfigurations
 bool PMSynthAudioProcessor::isBusesLayoutSupported (const BusesLayout& layouts) const
 {
@@ -144,10 +202,72 @@ void PMSynthAudioProcessor::processBlock (juce::AudioBuffer<float>& buffer, juce
 {
     // process synthesizer, delay and reverb
     juce::ScopedNoDenormals noDenormals;
+    RealtimeChecker::ScopedRealtime realtimeScope;
+    juce::int64 startTicks = juce::Time::getHighResolutionTicks();
+    // swap DSP implementations for the quality tier (non-realtime rendering always uses offline quality)
+    int blockQuality = isNonRealtime() ? Parameters::offlineQuality : int (*param.qualityParam);
+    if (blockQuality != quality)
+    {
+        quality = blockQuality;
+        synth.setQuality (quality);
+        reverb.setQuality (quality);
+    }
     buffer.clear();
-    synth.renderNextBlock (buffer, midiMessages, 0, buffer.getNumSamples());
-    delay.processBlock (buffer, buffer.getNumSamples());
-    reverb.processBlock (buffer, buffer.getNumSamples());
+    // in pipelined mode effects of the previous block are processed by the pipeline worker while the
+    // synthesizer renders this block (non-realtime rendering stays serial, so it has no latency);
+    // the mode is switched on the message thread, which reports the latency (see timerCallback())
+    bool blockPipelined = isPipelinedMode.load() && isNonRealtime() == false && pipeline.canProcess (buffer);
+    if (blockPipelined != isPipelined)
+    {
+        isPipelined = blockPipelined;
+        pipeline.reset();
+    }
+    if (isPipelined)
+    {
+        pipeline.process (buffer, [this, &midiMessages] (juce::AudioSampleBuffer& synthBuffer)
+        {
+            synth.renderNextBlock (synthBuffer, midiMessages, 0, synthBuffer.getNumSamples());
+        });
+    }
+    else
+    {
+        synth.renderNextBlock (buffer, midiMessages, 0, buffer.getNumSamples());
+        // effects are skipped while the pipeline worker finishes a block it was late with
+        if (pipeline.isSecondStageFree())
+            processEffects (buffer, buffer.getNumSamples());
+    }
+    recorder.processBlock (buffer, buffer.getNumSamples());
+    visualizerFifo.push (buffer.getReadPointer (0), buffer.getNumSamples());
+    presetBank.finishBlock();
+    // adapt polyphony to the processing load (offline rendering has no deadline)
+    if (isNonRealtime() == false && buffer.getNumSamples() > 0 && getSampleRate() > 0.0)
+    {
+        double blockTime = buffer.getNumSamples() / getSampleRate();
+        double processingTime = juce::Time::highResolutionTicksToSeconds (juce::Time::getHighResolutionTicks() - startTicks);
+        synth.setProcessingLoad (float (processingTime / blockTime));
+    }
+}
+
+void PMSynthAudioProcessor::timerCallback()
+{
+    // the latency is reported before the audio thread switches the mode, so host callbacks
+    // for the latency change run on the message thread; the worker thread runs only in pipelined mode
+    bool pipelinedMode = *param.pipelinedParam == true && isNonRealtime() == false;
+    if (pipelinedMode != isPipelinedMode.load())
+    {
+        if (pipelinedMode)
+            pipeline.startWorker();
+        setLatencySamples (pipelinedMode ? pipeline.getLatency() : 0);
+        isPipelinedMode.store (pipelinedMode);
+        if (pipelinedMode == false)
+            pipeline.stopWorker();
+    }
+}
+
+void PMSynthAudioProcessor::processEffects (juce::AudioBuffer<float>& buffer, int numSamples)
+{
+    delay.processBlock (buffer, numSamples);
+    reverb.processBlock (buffer, numSamples);
 }
 
 //==============================================================================
@@ -158,19 +278,28 @@ bool PMSynthAudioProcessor::hasEditor() const
 
 juce::AudioProcessorEditor* PMSynthAudioProcessor::createEditor()
 {
-    return new juce::GenericAudioProcessorEditor (*this);
+    return new PMSynthAudioProcessorEditor (*this);
 }
 
 //==============================================================================
 void PMSynthAudioProcessor::getStateInformation (juce::MemoryBlock& destData)
 {
-    auto state = param.apvts.copyState();
-    std::unique_ptr<juce::XmlElement> xml (state.createXml());
-    copyXmlToBinary (*xml, destData);
+    param.getBinaryState (destData);
+    presetBank.appendBinaryState (destData);
 }
 
 void PMSynthAudioProcessor::setStateInformation (const void* data, int sizeInBytes)
 {
+    int numValues = param.setBinaryState (data, sizeInBytes);
+    if (numValues > 0)
+    {
+        // stored presets follow parameter values
+        int paramStateSize = Parameters::getBinaryStateSize (numValues);
+        if (sizeInBytes > paramStateSize)
+            presetBank.setBinaryState (static_cast<const char*> (data) + paramStateSize, sizeInBytes - paramStateSize, numValues);
+        return;
+    }
+    // fall back to XML state saved by previous versions
     std::unique_ptr<juce::XmlElement> xmlState (getXmlFromBinary (data, sizeInBytes));
     if (xmlState.get() != nullptr)
     {
@@ -181,6 +310,17 @@ void PMSynthAudioProcessor::setStateInformation (const void* data, int sizeInByt
     }
 }
 
+//==============================================================================
+juce::String PMSynthAudioProcessor::startRecording (const juce::File& file)
+{
+    return recorder.start (file, getSampleRate(), getTotalNumOutputChannels());
+}
+
+void PMSynthAudioProcessor::stopRecording()
+{
+    recorder.stop();
+}
+
 //==============================================================================
 // This creates new instances of the plugin..
 juce::AudioProcessor* JUCE_CALLTYPE createPluginFilter()
@@ -13,11 +13,23 @@
 #include "Delay.h"
 #include "Reverb.h"
 #include "Parameters.h"
+#include "PresetBank.h"
+#include "SharedTables.h"
+#include "Recorder.h"
+#include "SampleFifo.h"
+#include "Pipeline.h"
+#include "RealtimeChecker.h"
+
+// number of operators in the build (4, 6 or 8) can be set with a preprocessor definition
+#ifndef PMSYNTH_NUM_OPERATORS
+ #define PMSYNTH_NUM_OPERATORS 4
+#endif
 
 //==============================================================================
 /**
 */
-class PMSynthAudioProcessor  : public juce::AudioProcessor
+class PMSynthAudioProcessor  : public juce::AudioProcessor,
+                               private juce::Timer
                             #if JucePlugin_Enable_ARA
                              , public juce::AudioProcessorARAExtension
                             #endif
@@ -30,6 +42,11 @@ public:
     //==============================================================================
     void prepareToPlay (double sampleRate, int samplesPerBlock) override;
     void releaseResources() override;
+    void reset() override;
+    void setNonRealtime (bool isNonRealtime) noexcept override;
+   #if JUCE_VERSION >= 0x70006
+    void audioWorkgroupContextChanged (const juce::AudioWorkgroup& workgroup) override;
+   #endif
 
    #ifndef JucePlugin_PreferredChannelConfigurations
     bool isBusesLayoutSupported (const BusesLayout& layouts) const override;
@@ -60,16 +77,52 @@ public:
     void getStateInformation (juce::MemoryBlock& destData) override;
     void setStateInformation (const void* data, int sizeInBytes) override;
 
+    //==============================================================================
+    /// start recording the output to a WAV or FLAC file (message thread)
+    /// @param const juce::File&, output file
+    /// @return juce::String, error message (empty if recording has started)
+    juce::String startRecording (const juce::File& file);
+    /// stop recording and close the file (message thread)
+    void stopRecording();
+    /// get the output recorder
+    /// @return const Recorder&, recorder (for the recording status)
+    const Recorder& getRecorder() const { return recorder; }
+    /// store the current sound to a program, keeping its name (message thread)
+    /// @param int, program index
+    void storeProgram (int index);
+    /// get parameters (for the editor)
+    /// @return Parameters&, parameters
+    Parameters& getParameterSet() { return param; }
+    /// get FIFO with output samples for the editor's visualizer
+    /// @return SampleFifo&, FIFO (is written only while the visualizer reads it)
+    SampleFifo& getVisualizerFifo() { return visualizerFifo; }
+
 private:
     // define constants
-    const int numVoices = 16;   // number of synthesizer voices
-    const int numOperators = 4; // number of operators
-    const int numLFOs = 2;      // number of LFOs
-
-    Parameters param;           // parameters from user interface
-    juce::Synthesiser synth;    // synthesizer
-    Delay delay;                // delay
-    Reverb reverb;              // reverb
+    const int numVoices = 16;                                  // number of synthesizer voices
+    static constexpr int numOperators = PMSYNTH_NUM_OPERATORS; // number of operators
+    const int numLFOs = 2;                                     // number of LFOs
+
+    SharedTable<SineTable> sineTable;            // sine wavetable shared between plugin instances
+
+    Parameters param;                            // parameters from user interface
+    PresetBank presetBank;                       // presets for program changes
+    PMSynthesiser synth;                         // synthesizer
+    Delay delay;                                 // delay
+    Reverb reverb;                               // reverb
+    Recorder recorder;                           // output recorder
+    SampleFifo visualizerFifo { 15 };            // output samples for the visualizer
+    Pipeline pipeline;                           // effects processed in parallel with the next block of the synthesizer
+    std::atomic<bool> isPipelinedMode { false }; // pipelined mode set on the message thread (its latency is reported)
+    bool isPipelined = false;                    // flag for the pipelined processing of the last block
+    int quality = -1;                            // render quality tier of the last block
+
+    /// apply delay and reverb
+    /// @param juce::AudioBuffer<float>&, buffer
+    /// @param int, number of samples
+    void processEffects (juce::AudioBuffer<float>& buffer, int numSamples);
+    /// switch pipelined processing and report its latency when the parameter changes (message thread)
+    void timerCallback() override;
     //==============================================================================
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (PMSynthAudioProcessor)
 };
@@ -0,0 +1,276 @@
+#ifndef PRESET_BANK_H
+#define PRESET_BANK_H
+
+#include <JuceHeader.h> // for JUCE classes
+#include <atomic>       // for std::atomic
+#include <memory>       // for unique_ptr
+#include <vector>       // for std::vector
+#include <cstring>      // for std::memcpy
+#include <algorithm>    // for std::remove_if
+#include "Parameters.h" // for accessing parameters set by the user interface
+
+/// Preset bank class.
+/// A class instance stores an in-memory bank of presets, where each preset
+/// is a ready-to-apply snapshot of raw parameter values in the layout order.
+/// The bank is never modified in place: the message thread builds a new bank
+/// and publishes it with an atomic pointer swap, so the audio thread can switch
+/// presets on MIDI Program Change without allocations, XML or locks. Voices read
+/// parameters when a note starts, so held notes keep their sound and new notes
+/// use the new preset. The host is notified of the new parameter values later
+/// on the message thread. Presets which weren't stored by the user are empty
+/// slots: selecting them keeps the current sound (hosts may select the current
+/// program after restoring the plugin state).
+class PresetBank : private juce::Timer
+{
+public:
+    static constexpr int numPresets = 128; // number of presets (MIDI program change range)
+
+    /// constructor which fills the bank with initial parameter values
+    /// @param Parameters*, pointer to the parameters class
+    PresetBank (Parameters* _param) :
+        param (_param)
+    {
+        auto bank = std::make_unique<Bank> (numPresets);
+        std::vector<float> initValues (size_t (param->getNumParameters()));
+        param->getRawValues (initValues.data());
+        for (auto& preset : *bank)
+        {
+            preset.name = "Init";
+            preset.values = initValues;
+        }
+        currentBank.store (bank.release());
+        startTimerHz (10);
+    }
+
+    /// destructor which frees the current and retired banks
+    ~PresetBank() override
+    {
+        stopTimer();
+        delete currentBank.load();
+    }
+
+    //==========================================================================
+    // audio thread
+
+    /// switch to a preset (called for MIDI Program Change, presets which weren't stored are ignored)
+    /// @param int, preset index
+    void selectPresetRealtime (int _index)
+    {
+        if (_index < 0 || _index >= numPresets)
+            return;
+        const Preset& preset = (*currentBank.load())[size_t (_index)];
+        if (preset.isStored == false)
+            return;
+        param->setRawValues (preset.values.data());
+        currentPreset.store (_index);
+        isHostUpdatePending.store (true);
+    }
+
+    /// mark the end of an audio block (allows freeing banks retired by the message thread)
+    void finishBlock()
+    {
+        audioBlockCounter.fetch_add (1);
+    }
+
+    //==========================================================================
+    // message thread
+
+    /// switch to a preset and notify the host (presets which weren't stored are ignored)
+    /// @param int, preset index
+    void selectPreset (int _index)
+    {
+        if (_index < 0 || _index >= numPresets)
+            return;
+        const Preset& preset = (*currentBank.load())[size_t (_index)];
+        if (preset.isStored == false)
+            return;
+        param->setRawValuesNotifyingHost (preset.values.data());
+        currentPreset.store (_index);
+    }
+
+    /// store current parameter values to a preset
+    /// @param int, preset index
+    /// @param const juce::String&, preset name
+    void storePreset (int _index, const juce::String& _name)
+    {
+        if (_index < 0 || _index >= numPresets)
+            return;
+        auto bank = std::make_unique<Bank> (*currentBank.load());
+        Preset& preset = (*bank)[size_t (_index)];
+        preset.name = _name;
+        param->getRawValues (preset.values.data());
+        preset.isStored = true;
+        publish (std::move (bank));
+    }
+
+    /// rename a preset without changing its values (names of presets which weren't stored
+    /// aren't saved with the plugin state)
+    /// @param int, preset index
+    /// @param const juce::String&, preset name
+    void renamePreset (int _index, const juce::String& _name)
+    {
+        if (_index < 0 || _index >= numPresets)
+            return;
+        auto bank = std::make_unique<Bank> (*currentBank.load());
+        (*bank)[size_t (_index)].name = _name;
+        publish (std::move (bank));
+    }
+
+    /// get index of the current preset
+    /// @return int, preset index
+    int getCurrentPreset() const
+    {
+        return currentPreset.load();
+    }
+
+    /// get preset name
+    /// @param int, preset index
+    /// @return juce::String, preset name
+    juce::String getPresetName (int _index) const
+    {
+        if (_index < 0 || _index >= numPresets)
+            return {};
+        return (*currentBank.load())[size_t (_index)].name;
+    }
+
+    /// append stored presets to the binary state
+    /// @param juce::MemoryBlock&, destination memory block
+    void appendBinaryState (juce::MemoryBlock& destData) const
+    {
+        const Bank& bank = *currentBank.load();
+        juce::uint32 numStored = 0;
+        for (auto& preset : bank)
+            numStored += preset.isStored ? 1 : 0;
+        writeValue (destData, bankMagic);
+        writeValue (destData, bankVersion);
+        writeValue (destData, juce::uint32 (currentPreset.load()));
+        writeValue (destData, numStored);
+        for (size_t i = 0; i < bank.size(); i++)
+        {
+            if (bank[i].isStored == false)
+                continue;
+            juce::uint32 nameSize = juce::uint32 (bank[i].name.getNumBytesAsUTF8());
+            writeValue (destData, juce::uint32 (i));
+            writeValue (destData, nameSize);
+            destData.append (bank[i].name.toRawUTF8(), nameSize);
+            destData.append (bank[i].values.data(), bank[i].values.size() * sizeof (float));
+        }
+    }
+
+    /// read stored presets from the binary state written by appendBinaryState()
+    /// @param const void*, state data (starting from the presets chunk)
+    /// @param int, state size in bytes
+    /// @param int, number of parameter values in each preset (presets saved with an older
+    ///             layout have less values, the rest of values are set to their defaults)
+    /// @return bool, false if data isn't a valid presets chunk
+    bool setBinaryState (const void* data, int sizeInBytes, int numSavedValues)
+    {
+        jassert (numSavedValues <= param->getNumParameters());
+        const char* ptr = static_cast<const char*> (data);
+        const char* end = ptr + sizeInBytes;
+        juce::uint32 magic, version, current, numStored;
+        if (! readValue (ptr, end, magic) || magic != bankMagic
+            || ! readValue (ptr, end, version) || version != bankVersion
+            || ! readValue (ptr, end, current) || ! readValue (ptr, end, numStored))
+            return false;
+        auto bank = std::make_unique<Bank> (*currentBank.load());
+        size_t valuesSize = size_t (numSavedValues) * sizeof (float);
+        std::vector<float> defaultValues (size_t (param->getNumParameters()));
+        param->getDefaultRawValues (defaultValues.data());
+        for (juce::uint32 i = 0; i < numStored; i++)
+        {
+            juce::uint32 index, nameSize;
+            if (! readValue (ptr, end, index) || index >= juce::uint32 (numPresets)
+                || ! readValue (ptr, end, nameSize) || size_t (end - ptr) < nameSize + valuesSize)
+                return false;
+            Preset& preset = (*bank)[index];
+            preset.name = juce::String::fromUTF8 (ptr, int (nameSize));
+            ptr += nameSize;
+            preset.values = defaultValues;
+            std::memcpy (preset.values.data(), ptr, valuesSize);
+            ptr += valuesSize;
+            preset.isStored = true;
+        }
+        publish (std::move (bank));
+        if (current < juce::uint32 (numPresets))
+            currentPreset.store (int (current));
+        return true;
+    }
+
+private:
+    /// preset snapshot
+    struct Preset
+    {
+        juce::String name;         // preset name
+        std::vector<float> values; // raw parameter values in the layout order
+        bool isStored = false;     // flag for presets stored by the user (are saved with the plugin state)
+    };
+    using Bank = std::vector<Preset>;
+
+    /// bank which was replaced and is waiting for the audio thread to stop using it
+    struct RetiredBank
+    {
+        std::unique_ptr<Bank> bank;     // retired bank
+        juce::uint64 audioBlockCounter; // audio block counter value when the bank was retired
+    };
+
+    static constexpr juce::uint32 bankMagic = 0x42504d50; // "PMPB" in little-endian byte order
+    static constexpr juce::uint32 bankVersion = 1;        // presets chunk version
+
+    Parameters* param;                                 // pointer to parameters set by the user interface
+    std::atomic<Bank*> currentBank { nullptr };        // current bank (is read by the audio thread)
+    std::atomic<int> currentPreset { 0 };              // current preset index
+    std::atomic<bool> isHostUpdatePending { false };   // flag for preset switched on the audio thread
+    std::atomic<juce::uint64> audioBlockCounter { 0 }; // number of finished audio blocks
+    std::vector<RetiredBank> retiredBanks;             // banks waiting to be freed (message thread only)
+
+    /// publish a new bank and retire the previous one
+    /// @param std::unique_ptr<Bank>, new bank
+    void publish (std::unique_ptr<Bank> _bank)
+    {
+        std::unique_ptr<Bank> oldBank (currentBank.exchange (_bank.release()));
+        retiredBanks.push_back ({ std::move (oldBank), audioBlockCounter.load() });
+        freeRetiredBanks();
+    }
+
+    /// free retired banks once the audio block which could read them has finished
+    void freeRetiredBanks()
+    {
+        juce::uint64 counter = audioBlockCounter.load();
+        retiredBanks.erase (std::remove_if (retiredBanks.begin(), retiredBanks.end(),
+                                            [counter] (const RetiredBank& r) { return counter > r.audioBlockCounter; }),
+                            retiredBanks.end());
+    }
+
+    /// notify the host of presets switched on the audio thread and free retired banks
+    void timerCallback() override
+    {
+        if (isHostUpdatePending.exchange (false))
+            param->notifyHostOfRawValues();
+        freeRetiredBanks();
+    }
+
+    /// append a value to a memory block
+    /// @param juce::MemoryBlock&, destination memory block
+    /// @param juce::uint32, value
+    static void writeValue (juce::MemoryBlock& destData, juce::uint32 value)
+    {
+        destData.append (&value, sizeof (value));
+    }
+
+    /// read a value and advance the read position
+    /// @param const char*&, read position
+    /// @param const char*, end of data
+    /// @param juce::uint32&, value
+    /// @return bool, false if there is not enough data
+    static bool readValue (const char*& ptr, const char* end, juce::uint32& value)
+    {
+        if (size_t (end - ptr) < sizeof (value))
+            return false;
+        std::memcpy (&value, ptr, sizeof (value));
+        ptr += sizeof (value);
+        return true;
+    }
+};
+
+#endif // PRESET_BANK_H
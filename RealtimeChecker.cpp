@@ -0,0 +1,247 @@
+/*
+  ==============================================================================
+
+    Real-time safety checker: replacements of the global allocation functions
+    and, on Linux, interposers of the C library's allocation, locking and blocking
+    functions. Everything is compiled only with PMSYNTH_REALTIME_CHECK=1 in
+    preprocessor definitions of an executable build (a plugin loaded by a host
+    can't interpose the host's C library functions).
+
+  ==============================================================================
+*/
+
+#include "RealtimeChecker.h"
+
+#if PMSYNTH_REALTIME_CHECK
+
+#include <cstdio>  // for std::fprintf
+#include <cstddef> // for std::max_align_t
+#include <cstdlib> // for std::malloc and std::free
+#include <new>     // for std::bad_alloc and std::align_val_t
+
+#if defined(__linux__)
+ #include <dlfcn.h>     // for dlsym()
+ #include <execinfo.h>  // for backtrace()
+ #include <pthread.h>   // for pthread functions
+ #include <sched.h>     // for sched_yield()
+ #include <semaphore.h> // for sem_wait()
+ #include <time.h>      // for nanosleep()
+ #include <unistd.h>    // for read(), write(), usleep() and fsync()
+#endif
+
+namespace RealtimeChecker
+{
+    constexpr int maxStackFrames = 32; // number of reported stack frames
+
+    void reportViolation (const char* _what)
+    {
+        if (isChecked() == false)
+            return;
+        isReporting = true;
+        numViolations.fetch_add (1);
+        std::fprintf (stderr, "Real-time violation: %s on the audio thread\n", _what);
+       #if defined(__linux__)
+        void* frames[maxStackFrames];
+        backtrace_symbols_fd (frames, backtrace (frames, maxStackFrames), STDERR_FILENO);
+       #endif
+        isReporting = false;
+    }
+}
+
+//==============================================================================
+// allocations
+
+#if defined(__GLIBC__)
+extern "C"
+{
+    void* __libc_malloc (size_t);
+    void* __libc_calloc (size_t, size_t);
+    void* __libc_realloc (void*, size_t);
+    void* __libc_memalign (size_t, size_t);
+    void __libc_free (void*);
+
+    void* malloc (size_t _size) noexcept
+    {
+        RealtimeChecker::reportViolation ("malloc()");
+        return __libc_malloc (_size);
+    }
+
+    void* calloc (size_t _num, size_t _size) noexcept
+    {
+        RealtimeChecker::reportViolation ("calloc()");
+        return __libc_calloc (_num, _size);
+    }
+
+    void* realloc (void* _ptr, size_t _size) noexcept
+    {
+        RealtimeChecker::reportViolation ("realloc()");
+        return __libc_realloc (_ptr, _size);
+    }
+
+    void free (void* _ptr) noexcept
+    {
+        if (_ptr != nullptr)
+            RealtimeChecker::reportViolation ("free()");
+        __libc_free (_ptr);
+    }
+}
+
+/// allocate memory without reporting (the caller reports)
+static void* allocate (size_t _size, size_t _alignment)
+{
+    return _alignment > alignof (std::max_align_t) ? __libc_memalign (_alignment, _size) : __libc_malloc (_size);
+}
+
+/// free memory without reporting (the caller reports)
+static void deallocate (void* _ptr)
+{
+    __libc_free (_ptr);
+}
+#else
+/// allocate memory without reporting (the caller reports)
+static void* allocate (size_t _size, size_t _alignment)
+{
+   #if defined(_MSC_VER)
+    return _aligned_malloc (_size, _alignment);
+   #else
+    void* ptr = nullptr;
+    if (_alignment > alignof (std::max_align_t))
+        return posix_memalign (&ptr, _alignment, _size) == 0 ? ptr : nullptr;
+    return std::malloc (_size);
+   #endif
+}
+
+/// free memory without reporting (the caller reports)
+static void deallocate (void* _ptr)
+{
+   #if defined(_MSC_VER)
+    _aligned_free (_ptr);
+   #else
+    std::free (_ptr);
+   #endif
+}
+#endif
+
+/// allocate memory for operator new and report the allocation
+static void* allocateChecked (size_t _size, size_t _alignment, const char* _what)
+{
+    RealtimeChecker::reportViolation (_what);
+    return allocate (_size == 0 ? 1 : _size, _alignment);
+}
+
+/// free memory for operator delete and report it
+static void deallocateChecked (void* _ptr)
+{
+    if (_ptr == nullptr)
+        return;
+    RealtimeChecker::reportViolation ("operator delete");
+    deallocate (_ptr);
+}
+
+void* operator new (size_t _size)
+{
+    if (void* ptr = allocateChecked (_size, alignof (std::max_align_t), "operator new"))
+        return ptr;
+    throw std::bad_alloc();
+}
+
+void* operator new[] (size_t _size)
+{
+    if (void* ptr = allocateChecked (_size, alignof (std::max_align_t), "operator new[]"))
+        return ptr;
+    throw std::bad_alloc();
+}
+
+void* operator new (size_t _size, const std::nothrow_t&) noexcept
+{
+    return allocateChecked (_size, alignof (std::max_align_t), "operator new");
+}
+
+void* operator new[] (size_t _size, const std::nothrow_t&) noexcept
+{
+    return allocateChecked (_size, alignof (std::max_align_t), "operator new[]");
+}
+
+void* operator new (size_t _size, std::align_val_t _alignment)
+{
+    if (void* ptr = allocateChecked (_size, size_t (_alignment), "aligned operator new"))
+        return ptr;
+    throw std::bad_alloc();
+}
+
+void* operator new[] (size_t _size, std::align_val_t _alignment)
+{
+    if (void* ptr = allocateChecked (_size, size_t (_alignment), "aligned operator new[]"))
+        return ptr;
+    throw std::bad_alloc();
+}
+
+void operator delete (void* _ptr) noexcept { deallocateChecked (_ptr); }
+void operator delete[] (void* _ptr) noexcept { deallocateChecked (_ptr); }
+void operator delete (void* _ptr, size_t) noexcept { deallocateChecked (_ptr); }
+void operator delete[] (void* _ptr, size_t) noexcept { deallocateChecked (_ptr); }
+void operator delete (void* _ptr, const std::nothrow_t&) noexcept { deallocateChecked (_ptr); }
+void operator delete[] (void* _ptr, const std::nothrow_t&) noexcept { deallocateChecked (_ptr); }
+void operator delete (void* _ptr, std::align_val_t) noexcept { deallocateChecked (_ptr); }
+void operator delete[] (void* _ptr, std::align_val_t) noexcept { deallocateChecked (_ptr); }
+void operator delete (void* _ptr, size_t, std::align_val_t) noexcept { deallocateChecked (_ptr); }
+void operator delete[] (void* _ptr, size_t, std::align_val_t) noexcept { deallocateChecked (_ptr); }
+
+//==============================================================================
+// locks and blocking system calls (Linux)
+
+#if defined(__linux__)
+/// find the next definition of an interposed function (the C library's one)
+/// @param std::atomic<void*>&, cached function pointer
+/// @param const char*, function name
+/// @return Function*, function
+template <typename Function>
+static Function* getNext (std::atomic<void*>& _cache, const char* _name)
+{
+    // no function-local statics: their guards may lock a mutex
+    void* function = _cache.load();
+    if (function == nullptr)
+    {
+        function = dlsym (RTLD_NEXT, _name);
+        _cache.store (function);
+    }
+    return reinterpret_cast<Function*> (function);
+}
+
+/// define an interposer which reports the call and calls the C library's function
+#define PMSYNTH_REALTIME_INTERPOSE(returnType, name, parameters, arguments, exceptionSpec) \
+    static std::atomic<void*> name##Next { nullptr }; \
+    extern "C" returnType name parameters exceptionSpec \
+    { \
+        RealtimeChecker::reportViolation (#name "()"); \
+        return getNext<returnType parameters> (name##Next, #name) arguments; \
+    }
+
+static std::atomic<void*> pthreadMutexLockNext { nullptr };
+
+/// lock a mutex (acquiring a free mutex can't block, so only waiting for a locked one is reported)
+extern "C" int pthread_mutex_lock (pthread_mutex_t* _mutex) noexcept
+{
+    if (RealtimeChecker::isChecked())
+    {
+        if (pthread_mutex_trylock (_mutex) == 0)
+            return 0;
+        RealtimeChecker::reportViolation ("waiting for a locked mutex");
+    }
+    return getNext<int (pthread_mutex_t*)> (pthreadMutexLockNext, "pthread_mutex_lock") (_mutex);
+}
+
+PMSYNTH_REALTIME_INTERPOSE (int, pthread_cond_wait, (pthread_cond_t* c, pthread_mutex_t* m), (c, m), )
+PMSYNTH_REALTIME_INTERPOSE (int, pthread_cond_timedwait, (pthread_cond_t* c, pthread_mutex_t* m, const struct timespec* t), (c, m, t), )
+PMSYNTH_REALTIME_INTERPOSE (int, sem_wait, (sem_t* s), (s), )
+PMSYNTH_REALTIME_INTERPOSE (int, sched_yield, (), (), noexcept)
+PMSYNTH_REALTIME_INTERPOSE (int, nanosleep, (const struct timespec* r, struct timespec* rem), (r, rem), )
+PMSYNTH_REALTIME_INTERPOSE (int, usleep, (useconds_t u), (u), )
+PMSYNTH_REALTIME_INTERPOSE (ssize_t, read, (int f, void* b, size_t n), (f, b, n), )
+PMSYNTH_REALTIME_INTERPOSE (ssize_t, write, (int f, const void* b, size_t n), (f, b, n), )
+PMSYNTH_REALTIME_INTERPOSE (int, fsync, (int f), (f), )
+
+#undef PMSYNTH_REALTIME_INTERPOSE
+#endif
+
+#endif // PMSYNTH_REALTIME_CHECK
@@ -0,0 +1,66 @@
+#ifndef REALTIME_CHECKER_H
+#define REALTIME_CHECKER_H
+
+#include <atomic> // for std::atomic
+
+/// Switch for the real-time safety checker (a debug and test mode, see RealtimeChecker.cpp).
+/// Add PMSYNTH_REALTIME_CHECK=1 to preprocessor definitions of an executable build
+/// (e.g. the batch renderer) to report allocations, waiting for locks and blocking
+/// system calls made by the audio thread inside processBlock().
+#ifndef PMSYNTH_REALTIME_CHECK
+ #define PMSYNTH_REALTIME_CHECK 0
+#endif
+
+/// Real-time safety checker.
+/// The audio thread is flagged while it is inside a realtime scope. With the checker
+/// switched on, allocations, waiting for locks and blocking system calls are intercepted
+/// and each one made by a flagged thread is reported with a stack trace. Places which
+/// are allowed to block (e.g. synchronous allocation for non-realtime rendering) are
+/// marked with an allow scope. With the checker switched off the scopes are empty.
+namespace RealtimeChecker
+{
+#if PMSYNTH_REALTIME_CHECK
+    inline thread_local int realtimeDepth = 0;    // number of nested realtime scopes on this thread
+    inline thread_local int allowDepth = 0;       // number of nested allow scopes on this thread
+    inline thread_local bool isReporting = false; // flag for a violation being reported (reporting may allocate)
+    inline std::atomic<int> numViolations { 0 };  // number of reported violations
+
+    /// check if the current thread is checked
+    /// @return bool, true inside a realtime scope and outside allow scopes
+    inline bool isChecked()
+    {
+        return realtimeDepth > 0 && allowDepth == 0 && isReporting == false;
+    }
+
+    /// report a violation with a stack trace if the current thread is checked (see RealtimeChecker.cpp)
+    /// @param const char*, description of the violation
+    void reportViolation (const char* _what);
+
+    /// get number of violations reported since the start of the process
+    /// @return int, number of violations
+    inline int getNumViolations()
+    {
+        return numViolations.load();
+    }
+
+    /// scope where the current thread must be real-time safe (e.g. processBlock())
+    struct ScopedRealtime
+    {
+        ScopedRealtime() { ++realtimeDepth; }
+        ~ScopedRealtime() { --realtimeDepth; }
+    };
+
+    /// scope where the current thread is allowed to block
+    struct ScopedAllow
+    {
+        ScopedAllow() { ++allowDepth; }
+        ~ScopedAllow() { --allowDepth; }
+    };
+#else
+    inline int getNumViolations() { return 0; }
+    struct ScopedRealtime { ScopedRealtime() {} };
+    struct ScopedAllow { ScopedAllow() {} };
+#endif
+}
+
+#endif // REALTIME_CHECKER_H
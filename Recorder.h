@@ -0,0 +1,221 @@
+#ifndef RECORDER_H
+#define RECORDER_H
+
+#include <JuceHeader.h> // for juce::AbstractFifo, audio formats and juce::TimeSliceThread
+#include <atomic>       // for std::atomic
+#include <memory>       // for unique_ptr
+
+/// Background thread which writes recordings to disk.
+/// A single thread is shared between all plugin instances in the process
+/// (it is accessed through juce::SharedResourcePointer).
+class RecorderThread : public juce::TimeSliceThread
+{
+public:
+    /// constructor which starts the thread
+    RecorderThread() :
+        juce::TimeSliceThread ("PMSynth recorder")
+    {
+        startThread();
+    }
+
+    /// destructor which stops the thread
+    ~RecorderThread() override
+    {
+        stopThread (1000);
+    }
+};
+
+/// Recorder class.
+/// A class instance records the plugin output to a WAV or FLAC file. The audio thread
+/// copies each block into a FIFO which is allocated when recording starts, and the
+/// background thread drains the FIFO to the file in large sequential writes. The audio
+/// thread never waits for the disk: blocks which don't fit into the FIFO are dropped
+/// and counted, and the number of dropped samples is reported when recording stops.
+class Recorder : private juce::TimeSliceClient
+{
+public:
+    /// destructor which finishes the recording
+    ~Recorder() override
+    {
+        stop();
+    }
+
+    //==========================================================================
+    // message thread
+
+    /// start recording (the format is FLAC for files with the .flac extension and WAV otherwise)
+    /// @param const juce::File&, output file (is overwritten)
+    /// @param double, sample rate [Hz]
+    /// @param int, number of channels (1 or 2)
+    /// @return juce::String, error message (empty if recording has started)
+    juce::String start (const juce::File& _file, double _sampleRate, int _numChannels)
+    {
+        stop();
+        if (_sampleRate <= 0.0)
+            return "the plugin isn't prepared to play";
+        sampleRate = _sampleRate;
+        numChannels = juce::jlimit (1, 2, _numChannels);
+        _file.deleteFile();
+        std::unique_ptr<juce::OutputStream> stream (_file.createOutputStream (streamBufferSize));
+        std::unique_ptr<juce::AudioFormat> format;
+        if (_file.hasFileExtension ("flac"))
+            format = std::make_unique<juce::FlacAudioFormat>();
+        else
+            format = std::make_unique<juce::WavAudioFormat>();
+        if (stream != nullptr)
+            writer.reset (format->createWriterFor (stream.get(), _sampleRate, juce::uint32 (numChannels), bitsPerSample, {}, 0));
+        if (writer == nullptr)
+            return "can't write " + _file.getFullPathName();
+        stream.release(); // the writer owns the stream
+        // allocate the FIFO before the audio thread can use it
+        int fifoSize = int (fifoSeconds * _sampleRate);
+        fifoBuffer.setSize (numChannels, fifoSize);
+        fifo.setTotalSize (fifoSize);
+        fifo.reset();
+        numDroppedSamples.store (0);
+        numRecordedSamples.store (0);
+        hasWriteError.store (false);
+        writeBlockSize = juce::jmin (int (writeSeconds * _sampleRate), fifoSize / 2);
+        thread->addTimeSliceClient (this);
+        isActive.store (true);
+        return {};
+    }
+
+    /// stop recording, write the rest of the FIFO and close the file
+    void stop()
+    {
+        if (isActive.exchange (false) == false)
+            return;
+        // wait for the audio thread to finish the block where it could have written to the FIFO
+        while (isInUse.load())
+            juce::Thread::sleep (1);
+        thread->removeTimeSliceClient (this);
+        writeFromFifo (fifo.getNumReady());
+        writer.reset();
+        fifoBuffer.setSize (0, 0);
+        if (numDroppedSamples.load() > 0 || hasWriteError.load())
+            juce::Logger::writeToLog (getStatus());
+    }
+
+    /// check if recording is active
+    /// @return bool, true while recording
+    bool isRecording() const
+    {
+        return isActive.load();
+    }
+
+    /// get sample rate of the current or last recording
+    /// @return double, sample rate [Hz]
+    double getSampleRate() const
+    {
+        return sampleRate;
+    }
+
+    /// get number of samples dropped because the FIFO was full
+    /// @return juce::int64, number of dropped samples per channel in the current or last recording
+    juce::int64 getNumDroppedSamples() const
+    {
+        return numDroppedSamples.load();
+    }
+
+    /// get status of the current or last recording
+    /// @return juce::String, number of written and dropped samples and write errors
+    juce::String getStatus() const
+    {
+        juce::String status;
+        status << "recorded " << juce::String (numRecordedSamples.load()) << " samples, dropped "
+               << juce::String (numDroppedSamples.load()) << " samples";
+        if (hasWriteError.load())
+            status << ", disk write failed";
+        return status;
+    }
+
+    //==========================================================================
+    // audio thread
+
+    /// copy an audio block into the FIFO (the block is dropped if it doesn't fit)
+    /// @param const juce::AudioBuffer&, output audio buffer
+    /// @param int, number of samples in the buffer
+    void processBlock (const juce::AudioSampleBuffer& _buffer, int _numSamples)
+    {
+        if (isActive.load() == false)
+            return;
+        isInUse.store (true);
+        if (isActive.load())
+        {
+            if (fifo.getFreeSpace() < _numSamples)
+                numDroppedSamples.fetch_add (_numSamples);
+            else
+            {
+                int start1, size1, start2, size2;
+                fifo.prepareToWrite (_numSamples, start1, size1, start2, size2);
+                for (int i = 0; i < numChannels; i++)
+                {
+                    // mono output is duplicated to both channels of a stereo file
+                    int channel = juce::jmin (i, _buffer.getNumChannels() - 1);
+                    fifoBuffer.copyFrom (i, start1, _buffer.getReadPointer (channel), size1);
+                    if (size2 > 0)
+                        fifoBuffer.copyFrom (i, start2, _buffer.getReadPointer (channel, size1), size2);
+                }
+                fifo.finishedWrite (size1 + size2);
+            }
+        }
+        isInUse.store (false);
+    }
+
+private:
+    static constexpr double fifoSeconds = 4.0;          // FIFO length (time the disk can stall without dropouts) [sec]
+    static constexpr double writeSeconds = 0.5;         // amount of audio in a single disk write [sec]
+    static constexpr int bitsPerSample = 24;            // output bit depth
+    static constexpr size_t streamBufferSize = 1 << 18; // file stream buffer size [bytes]
+
+    juce::SharedResourcePointer<RecorderThread> thread; // background thread shared by all plugin instances
+    std::unique_ptr<juce::AudioFormatWriter> writer;    // file writer (message and background threads)
+    juce::AudioSampleBuffer fifoBuffer;                 // FIFO samples
+    juce::AbstractFifo fifo { 1 };                      // FIFO positions
+    double sampleRate = 0.0;                            // sample rate of the recording [Hz]
+    int numChannels = 2;                                // number of recorded channels
+    int writeBlockSize = 0;                             // minimum number of samples in a disk write
+    std::atomic<bool> isActive { false };               // flag for active recording
+    std::atomic<bool> isInUse { false };                // flag for the FIFO being written by the audio thread
+    std::atomic<bool> hasWriteError { false };          // flag for failed disk writes
+    std::atomic<juce::int64> numDroppedSamples { 0 };   // number of samples dropped because the FIFO was full
+    std::atomic<juce::int64> numRecordedSamples { 0 };  // number of samples written to the file
+
+    /// write samples from the FIFO to the file
+    /// @param int, number of samples
+    void writeFromFifo (int _numSamples)
+    {
+        if (_numSamples <= 0)
+            return;
+        int start1, size1, start2, size2;
+        fifo.prepareToRead (_numSamples, start1, size1, start2, size2);
+        const float* channels[2];
+        for (int i = 0; i < numChannels; i++)
+            channels[i] = fifoBuffer.getReadPointer (i, start1);
+        bool isWritten = writer->writeFromFloatArrays (channels, numChannels, size1);
+        if (size2 > 0)
+        {
+            for (int i = 0; i < numChannels; i++)
+                channels[i] = fifoBuffer.getReadPointer (i, start2);
+            isWritten = writer->writeFromFloatArrays (channels, numChannels, size2) && isWritten;
+        }
+        fifo.finishedRead (size1 + size2);
+        numRecordedSamples.fetch_add (size1 + size2);
+        if (isWritten == false)
+            hasWriteError.store (true);
+    }
+
+    /// write the FIFO to the file once enough samples are ready (background thread)
+    /// @return int, time until the next call [ms]
+    int useTimeSlice() override
+    {
+        int numReady = fifo.getNumReady();
+        if (numReady < writeBlockSize)
+            return 50;
+        writeFromFifo (numReady);
+        return 10;
+    }
+};
+
+#endif // RECORDER_H
@@ -1,19 +1,29 @@
 #ifndef REVERB_H
 #define REVERB_H
 
-#include <JuceHeader.h> // for JUCE classes
-#include "Parameters.h" // for accessing parameters set by the user interface
+#include <JuceHeader.h>   // for JUCE classes
+#include <cmath>          // for std::log and std::sqrt
+#include "Parameters.h"   // for accessing parameters set by the user interface
+#include "LazyResource.h" // for allocating reverb on demand
 
 /// Reverb class.
 /// This class is a wrapper class around juce::Reverb that adds parameter
 /// mapping so the effect can be controlled from the user interface.
+/// The reverb is allocated on a background thread when it is switched on
+/// and is released after it has been switched off for a while. Once the
+/// input is silent and the reverb output has decayed below the silence
+/// threshold, the reverb is reset and processing is skipped until the
+/// input is not silent again. In draft quality a single reverb channel
+/// processes the mid signal of a stereo input with the gains of the stereo
+/// reverb, so switching the quality doesn't change the mix level.
 class Reverb
 {
 public:
     /// initialise parameters pointer
     /// @param Parameters*, pointer to the parameters class
     Reverb (Parameters* _param) :
-        param (_param)
+        param (_param),
+        reverbResource (releaseTimeMs)
     {
     }
 
@@ -21,9 +31,23 @@ public:
     /// @param float, sample rate [Hz]
     void prepareToPlay (float _sampleRate)
     {
-        // reset reverb
-        resetReverb();
-        reverb.setSampleRate (_sampleRate);
+        holdSamples = int (std::ceil (holdTime * _sampleRate));
+        // reverb is allocated when it is switched on
+        double sampleRate = _sampleRate;
+        reverbResource.prepare ([sampleRate]
+        {
+            auto newReverb = std::make_unique<juce::Reverb>();
+            newReverb->setSampleRate (sampleRate);
+            return newReverb;
+        });
+        reverb = nullptr;
+    }
+
+    /// free reverb
+    void releaseResources()
+    {
+        reverbResource.releaseNow();
+        reverb = nullptr;
     }
 
     /// apply reverb to an audio buffer
@@ -34,43 +58,161 @@ public:
         // check on/off switch
         if (*param->reverbOnParam == false)
         {
-            if (isReverbReset == false)
-                resetReverb();
+            isOn = false;
+            return;
+        }
+        // get reverb (the output is dry until it is allocated)
+        juce::Reverb* currentReverb = reverbResource.acquire();
+        if (currentReverb == nullptr)
+        {
+            reverbResource.finishUse();
+            return;
+        }
+        if (currentReverb != reverb)
+        {
+            // new reverb is allocated in reset state but needs parameters
+            reverb = currentReverb;
+            parametersVersion = Parameters::unseenVersion;
+            isIdle = true;
+        }
+        else if (isOn == false)
+        {
+            // reset reverb which was used before it was switched off
+            reverb->reset();
+            parametersVersion = Parameters::unseenVersion;
+            isIdle = true;
+        }
+        isOn = true;
+        // skip processing of the silent input if the reverb has no tail
+        bool isInputSilent = outputBuffer.getMagnitude (0, numSamples) < silenceThreshold;
+        if (isIdle && isInputSilent)
+        {
+            reverbResource.finishUse();
             return;
         }
-        isReverbReset = false;
+        isIdle = false;
         // process reverb
-        updateParameters();
+        if (param->hasChanged (Parameters::reverbGroup, parametersVersion))
+            updateParameters();
         int numChannels = outputBuffer.getNumChannels();
         if (numChannels == 1)
-            reverb.processMono (outputBuffer.getWritePointer (0), numSamples);
+            reverb->processMono (outputBuffer.getWritePointer (0), numSamples);
+        else if (numChannels == 2 && quality == Parameters::draftQuality)
+            processMidWet (outputBuffer.getWritePointer (0), outputBuffer.getWritePointer (1), numSamples);
         else if (numChannels == 2)
-            reverb.processStereo (outputBuffer.getWritePointer (0), outputBuffer.getWritePointer (1), numSamples);
+            reverb->processStereo (outputBuffer.getWritePointer (0), outputBuffer.getWritePointer (1), numSamples);
+        // with the silent input the output is the reverb tail only
+        if (isInputSilent && outputBuffer.getMagnitude (0, numSamples) < silenceThreshold)
+            silentSamples += numSamples;
+        else
+            silentSamples = 0;
+        if (silentSamples >= holdSamples)
+        {
+            // the tail has decayed: clear what is left of it and stop processing
+            reverb->reset();
+            isIdle = true;
+            silentSamples = 0;
+        }
+        reverbResource.finishUse();
+    }
+
+    /// set render quality
+    /// @param int, quality tier (see Parameters.h)
+    void setQuality (int _quality)
+    {
+        if (_quality == quality)
+            return;
+        quality = _quality;
+        // gains are set differently for the mid wet signal in draft quality
+        parametersVersion = Parameters::unseenVersion;
+    }
+
+    /// set non-realtime mode (the reverb is allocated in place instead of on the background thread)
+    /// @param bool, flag for non-realtime rendering
+    void setNonRealtime (bool _isNonRealtime)
+    {
+        reverbResource.setSynchronous (_isNonRealtime);
+    }
+
+    /// get length of the reverb tail for the current parameters
+    /// @return double, time until the reverb tail decays below the silence threshold [sec]
+    double getTailLengthSeconds() const
+    {
+        if (*param->reverbOnParam == false || *param->reverbDryWetParam == 0.0f)
+            return 0.0;
+        // juce::Reverb comb filters feedback and the longest comb filter delay (independent of sample rate)
+        double combFeedback = *param->reverbRoomSizeParam * 0.28 + 0.7;
+        double combTime = (1617.0 + 23.0) / 44100.0;
+        return combTime * std::log (double (silenceThreshold)) / std::log (combFeedback) + holdTime;
     }
 private:
     // base members
-    juce::Reverb reverb; // reverb
-    Parameters* param;   // pointer to parameters set by the user interface
-    bool isReverbReset;  // flag for reseted reverb state
+    juce::Reverb* reverb = nullptr;                             // reverb used in the current block
+    Parameters* param;                                          // pointer to parameters set by the user interface
+    bool isOn = false;                                          // flag for reverb switched on in the previous block
+    juce::uint32 parametersVersion = Parameters::unseenVersion; // last seen version of reverb parameters
+    // silence detection
+    static constexpr float silenceThreshold = 1e-5f;            // level below which signal is treated as silence (-100 dBFS)
+    static constexpr float holdTime = 0.2f;                     // time the output should stay silent before processing stops (longer than the reverb delay lines) [sec]
+    int holdSamples = 0;                                        // hold time [samples]
+    int silentSamples = 0;                                      // number of samples since the output was above the silence threshold
+    bool isIdle = true;                                         // flag for reverb which is reset and isn't processed
+    // quality
+    int quality = Parameters::realtimeQuality;                  // render quality tier
+    static constexpr int midBlockSize = 64;                     // size of the mid signal block in draft quality
+    float midBlock[midBlockSize];                               // mid signal which is processed by the reverb in draft quality
+    float dryGain = 1.0f;                                       // dry gain applied outside of the reverb in draft quality
+    float midWetGain = 1.0f;                                    // gain of the mid wet signal which matches the level of the stereo wet signal
+    static constexpr float dryScaleFactor = 2.0f;               // dry gain of juce::Reverb for the dry level of 1
+    // reverb memory
+    static constexpr int releaseTimeMs = 30000;                 // time after which unused reverb is released [ms]
+    LazyResource<juce::Reverb> reverbResource;                  // reverb allocated on demand
 
     /// assign user interface parameters values to reverb
     void updateParameters()
     {
         // set reverb parameters
         juce::Reverb::Parameters reverbParameters;
-        reverbParameters.dryLevel = 1.0f - *param->reverbDryWetParam;
-        reverbParameters.wetLevel = 1.0f - reverbParameters.dryLevel;
+        float dryLevel = 1.0f - *param->reverbDryWetParam;
+        float width = *param->reverbWidthParam;
+        reverbParameters.dryLevel = dryLevel;
+        reverbParameters.wetLevel = 1.0f - dryLevel;
         reverbParameters.roomSize = *param->reverbRoomSizeParam;
-        reverbParameters.width = *param->reverbWidthParam;
+        reverbParameters.width = width;
         reverbParameters.damping = *param->reverbDampingParam;
-        reverb.setParameters (reverbParameters);
+        if (quality == Parameters::draftQuality)
+        {
+            // the mono reverb outputs the wet signal only with the full wet gain (width of 1); stereo channels
+            // mix two decorrelated wet signals with gains 0.5 * (1 + width) and 0.5 * (1 - width), which sum
+            // to a level of sqrt (0.5 * (1 + width^2)) of the full wet gain
+            dryGain = dryScaleFactor * dryLevel;
+            midWetGain = std::sqrt (0.5f * (1.0f + width * width));
+            reverbParameters.dryLevel = 0.0f;
+            reverbParameters.width = 1.0f;
+        }
+        reverb->setParameters (reverbParameters);
     }
-    
-    /// reset reverb
-    void resetReverb()
+
+    /// process stereo samples with a single reverb channel fed by the mid signal (draft quality);
+    /// the stereo reverb is fed by the sum of channels, so the mid signal is the sum as well
+    /// @param float*, left channel samples
+    /// @param float*, right channel samples
+    /// @param int, number of samples
+    void processMidWet (float* _left, float* _right, int _numSamples)
     {
-        reverb.reset();
-        isReverbReset = true;
+        for (int start = 0; start < _numSamples; start += midBlockSize)
+        {
+            int blockSamples = juce::jmin (midBlockSize, _numSamples - start);
+            for (int n = 0; n < blockSamples; n++)
+                midBlock[n] = _left[start + n] + _right[start + n];
+            // the reverb outputs the wet signal only
+            reverb->processMono (midBlock, blockSamples);
+            for (int n = 0; n < blockSamples; n++)
+            {
+                _left[start + n] = dryGain * _left[start + n] + midWetGain * midBlock[n];
+                _right[start + n] = dryGain * _right[start + n] + midWetGain * midBlock[n];
+            }
+        }
     }
 };
 
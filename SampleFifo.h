@@ -0,0 +1,85 @@
+#ifndef SAMPLE_FIFO_H
+#define SAMPLE_FIFO_H
+
+#include <JuceHeader.h> // for juce::uint32
+#include <atomic>       // for std::atomic
+#include <cstring>      // for std::memcpy
+#include <vector>       // for std::vector
+
+/// Sample FIFO class.
+/// A wait-free single-producer single-consumer FIFO which passes samples from
+/// the audio thread to the message thread (e.g. for visualization). The buffer is
+/// allocated in the constructor and its size is a power of two, so the read and write
+/// positions are free-running counters. The audio thread writes nothing while the
+/// reader isn't active, and a block which doesn't fit is dropped instead of waiting.
+class SampleFifo
+{
+public:
+    /// constructor which allocates the buffer
+    /// @param int, base 2 logarithm of the buffer size [samples]
+    SampleFifo (int _sizeLog2) :
+        size (juce::uint32 (1) << _sizeLog2), buffer (size)
+    {
+    }
+
+    //==========================================================================
+    // audio thread
+
+    /// write a block of samples (the block is dropped if the reader isn't active or the FIFO is full)
+    /// @param const float*, samples
+    /// @param int, number of samples
+    void push (const float* _samples, int _numSamples)
+    {
+        if (isReaderActive.load (std::memory_order_relaxed) == false)
+            return;
+        juce::uint32 write = writePosition.load (std::memory_order_relaxed);
+        juce::uint32 numSamples = juce::uint32 (_numSamples);
+        if (size - (write - readPosition.load (std::memory_order_acquire)) < numSamples)
+            return;
+        // a single copy unless the block wraps around the end of the buffer
+        juce::uint32 start = write & (size - 1);
+        juce::uint32 numFirst = juce::jmin (numSamples, size - start);
+        std::memcpy (buffer.data() + start, _samples, numFirst * sizeof (float));
+        if (numSamples > numFirst)
+            std::memcpy (buffer.data(), _samples + numFirst, (numSamples - numFirst) * sizeof (float));
+        writePosition.store (write + numSamples, std::memory_order_release);
+    }
+
+    //==========================================================================
+    // message thread
+
+    /// start or stop reading (samples written before the reader starts are skipped)
+    /// @param bool, flag for an active reader
+    void setReaderActive (bool _isActive)
+    {
+        if (_isActive)
+            readPosition.store (writePosition.load (std::memory_order_acquire), std::memory_order_release);
+        isReaderActive.store (_isActive);
+    }
+
+    /// read available samples
+    /// @param float*, destination array
+    /// @param int, maximum number of samples to read
+    /// @return int, number of samples read
+    int pop (float* _samples, int _maxSamples)
+    {
+        juce::uint32 read = readPosition.load (std::memory_order_relaxed);
+        juce::uint32 numSamples = juce::jmin (writePosition.load (std::memory_order_acquire) - read, juce::uint32 (_maxSamples));
+        juce::uint32 start = read & (size - 1);
+        juce::uint32 numFirst = juce::jmin (numSamples, size - start);
+        std::memcpy (_samples, buffer.data() + start, numFirst * sizeof (float));
+        if (numSamples > numFirst)
+            std::memcpy (_samples + numFirst, buffer.data(), (numSamples - numFirst) * sizeof (float));
+        readPosition.store (read + numSamples, std::memory_order_release);
+        return int (numSamples);
+    }
+
+private:
+    const juce::uint32 size;                       // buffer size (a power of two) [samples]
+    std::vector<float> buffer;                     // samples
+    std::atomic<juce::uint32> writePosition { 0 }; // number of samples written (audio thread)
+    std::atomic<juce::uint32> readPosition { 0 };  // number of samples read (message thread)
+    std::atomic<bool> isReaderActive { false };    // flag for an active reader
+};
+
+#endif // SAMPLE_FIFO_H
@@ -0,0 +1,112 @@
+#ifndef SHARED_LFOS_H
+#define SHARED_LFOS_H
+
+#include <JuceHeader.h>    // for JUCE classes
+#include "LFO.h"           // for LFOs
+#include "ModMatrix.h"     // for LFOs routing
+#include "Parameters.h"    // for accessing parameters set by the user interface
+#include "VoiceTemplate.h" // for LFO values
+
+/// Shared LFOs class.
+/// An LFO which isn't retriggered by notes runs freely, so all voices follow the same
+/// phase. Such LFOs are rendered here once per modulation block for all voices, and voices
+/// route the shared output to their own destinations instead of rendering their own copies.
+/// An LFO stays in voices if its rate or amount is modulated by an LFO which is rendered in
+/// voices, since its output then differs between voices.
+class SharedLFOs
+{
+public:
+    /// constructor which assigns parameters
+    /// @param Parameters*, pointer to parameters set by the user interface
+    SharedLFOs (Parameters* _param) :
+        param (_param),
+        lfo {_param->apvts.getParameterRange("lfo1Rate"), _param->apvts.getParameterRange("lfo2Rate")},
+        modMatrix (_param->numOperators, _param->numLFOs)
+    {
+    }
+
+    /// prepare LFOs for a sample rate (the free-running phases restart)
+    /// @param float, sample rate [Hz]
+    void prepare (float _sampleRate)
+    {
+        for (int i = 0; i < param->numLFOs; i++)
+        {
+            parametersVersion[i] = param->getVersion (param->getLFOGroup (i));
+            VoiceTemplate::LFO values;
+            values.build (param, i);
+            lfo[i].startNote (values, _sampleRate);
+            isShared[i] = false;
+        }
+        sampleRate = _sampleRate;
+    }
+
+    /// set render quality of LFOs
+    /// @param int, quality tier (see Parameters.h)
+    void setQuality (int _quality)
+    {
+        for (int i = 0; i < param->numLFOs; i++)
+            lfo[i].setQuality (_quality);
+    }
+
+    /// render shared LFOs for the next modulation block
+    /// @param int, number of samples in the block (up to the modulation block size)
+    void process (int _numSamples)
+    {
+        if (sampleRate <= 0.0f)
+            return;
+        modMatrix.beginBlock (param, _numSamples);
+        // an LFO can only modulate LFOs with a lower index, so LFOs are rendered in reverse order
+        for (int i = param->numLFOs - 1; i >= 0; i--)
+        {
+            isShared[i] = *param->lfoOnParam[i] == true && *param->lfoRetriggerParam[i] == false && isModulatedInVoices (i) == false;
+            if (isShared[i] == false)
+                continue;
+            // LFO values are read directly (voice templates are only rebuilt when notes start)
+            if (param->hasChanged (param->getLFOGroup (i), parametersVersion[i]))
+            {
+                VoiceTemplate::LFO values;
+                values.build (param, i);
+                lfo[i].setParameters (values);
+            }
+            int rateDestination = modMatrix.getLFORateDestination (i);
+            lfo[i].process (modMatrix.getSourceBuffer (i),
+                            modMatrix.isDestinationRouted (rateDestination) ? modMatrix.getDestination (rateDestination) : nullptr,
+                            modMatrix.getDestination (modMatrix.getLFOAmountDestination (i)),
+                            _numSamples);
+            modMatrix.applyRoutes (i, _numSamples);
+        }
+    }
+
+    /// get output of a shared LFO in the current modulation block
+    /// @param int, LFO index
+    /// @return const float*, LFO output (nullptr if the LFO is rendered in voices)
+    const float* getOutput (int _idx)
+    {
+        return isShared[_idx] ? modMatrix.getSourceBuffer (_idx) : nullptr;
+    }
+
+private:
+    Parameters* param;                      // parameters set by the user interface
+    LFO lfo[2];                             // two LFOs
+    ModMatrix modMatrix;                    // routing between shared LFOs
+    bool isShared[2] = {};                  // flags for LFOs shared in the current block
+    juce::uint32 parametersVersion[2] = {}; // last seen versions of LFO parameters (are set in prepare())
+    float sampleRate = 0.0f;                // sample rate [Hz]
+
+    /// check if an LFO is modulated by an LFO which is rendered in voices
+    /// @param int, LFO index
+    /// @return bool, true if the rate or amount of the LFO is modulated by an LFO which isn't shared
+    bool isModulatedInVoices (int _idx) const
+    {
+        for (int j = _idx + 1; j < param->numLFOs; j++)
+        {
+            int destination = int (*param->lfoDestinationParam[j]);
+            bool isModulating = destination == modMatrix.getLFORateDestination (_idx) || destination == modMatrix.getLFOAmountDestination (_idx);
+            if (*param->lfoOnParam[j] == true && isModulating && isShared[j] == false)
+                return true;
+        }
+        return false;
+    }
+};
+
+#endif // SHARED_LFOS_H
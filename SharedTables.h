@@ -0,0 +1,80 @@
+#ifndef SHARED_TABLES_H
+#define SHARED_TABLES_H
+
+#include <JuceHeader.h> // for juce::CriticalSection and juce::SharedResourcePointer
+#include <map>          // for std::map
+#include <memory>       // for shared_ptr and weak_ptr
+#include <typeindex>    // for std::type_index
+#include <utility>      // for std::pair
+
+/// Registry of read-only DSP tables shared by all plugin instances in the process.
+/// A single registry is shared between plugin instances (it is accessed through
+/// juce::SharedResourcePointer). Each table is built once for its type and sample rate
+/// when the first user asks for it, is shared immutably by all users and is freed
+/// when the last user releases it. Tables are built on the thread which asks for them
+/// (e.g. in the processor constructor or prepareToPlay()), never on the audio thread.
+/// A table type should have a constructor which takes the sample rate.
+class TableRegistry
+{
+public:
+    /// get a shared table (the table is built if no one is using it yet)
+    /// @param double, sample rate of the table [Hz] (0 for tables which don't depend on it)
+    /// @return std::shared_ptr<const Table>, shared table
+    template <typename Table>
+    std::shared_ptr<const Table> acquire (double _sampleRate)
+    {
+        const juce::ScopedLock lock (tablesLock);
+        Key key (std::type_index (typeid (Table)), _sampleRate);
+        if (auto table = tables[key].lock())
+            return std::static_pointer_cast<const Table> (table);
+        removeExpired();
+        auto table = std::make_shared<const Table> (_sampleRate);
+        tables[key] = table;
+        return table;
+    }
+
+private:
+    using Key = std::pair<std::type_index, double>; // table type and sample rate
+
+    juce::CriticalSection tablesLock;                // lock for the tables map
+    std::map<Key, std::weak_ptr<const void>> tables; // tables which can still be in use
+
+    /// remove entries of tables which were freed
+    void removeExpired()
+    {
+        for (auto it = tables.begin(); it != tables.end();)
+            it = it->second.expired() ? tables.erase (it) : std::next (it);
+    }
+};
+
+/// Shared table handle.
+/// A class instance keeps a table from the process-wide registry alive
+/// and acquires the table again when the sample rate changes.
+template <typename Table>
+class SharedTable
+{
+public:
+    /// get the table for a sample rate (call only when the audio thread isn't processing, e.g. in prepareToPlay())
+    /// @param double, sample rate [Hz] (0 for tables which don't depend on it)
+    void prepare (double _sampleRate)
+    {
+        if (table != nullptr && sampleRate == _sampleRate)
+            return;
+        table = registry->template acquire<Table> (_sampleRate);
+        sampleRate = _sampleRate;
+    }
+
+    /// get the table
+    /// @return const Table*, table or nullptr if it wasn't prepared
+    const Table* get() const
+    {
+        return table.get();
+    }
+
+private:
+    juce::SharedResourcePointer<TableRegistry> registry; // process-wide tables registry
+    std::shared_ptr<const Table> table;                  // shared table
+    double sampleRate = 0.0;                             // sample rate of the table [Hz]
+};
+
+#endif // SHARED_TABLES_H
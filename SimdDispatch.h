@@ -0,0 +1,100 @@
+#ifndef SIMD_DISPATCH_H
+#define SIMD_DISPATCH_H
+
+#include <cstdlib> // for std::getenv
+#include <cstring> // for std::strcmp
+
+/// Switch for the runtime CPU-feature dispatch of the DSP kernels.
+/// The voice rendering (operators, unison lanes, voice filter and mixing), the shared
+/// filter and the delay are compiled for the baseline (SSE2 on x86-64), AVX2 and AVX-512,
+/// and the best tier supported by the CPU is selected in prepareToPlay(). The dispatch uses
+/// GCC and Clang target attributes on x86; other builds (or builds with PMSYNTH_SIMD_DISPATCH=0
+/// in preprocessor definitions) have only the baseline kernels.
+#ifndef PMSYNTH_SIMD_DISPATCH
+ #if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+  #define PMSYNTH_SIMD_DISPATCH 1
+ #else
+  #define PMSYNTH_SIMD_DISPATCH 0
+ #endif
+#endif
+
+#if PMSYNTH_SIMD_DISPATCH
+ // a kernel entry point is compiled for the tier together with every call inlined into it
+ #define PMSYNTH_SIMD_AVX2 __attribute__ ((target ("avx2,fma"), flatten))
+ #define PMSYNTH_SIMD_AVX512 __attribute__ ((target ("avx512f,avx512vl,avx512dq,avx512bw,avx2,fma"), flatten))
+#endif
+
+/// SIMD tiers of the DSP kernels and their selection.
+/// A kernel is a template or inline function written as plain loops, and each tier has an entry
+/// point which calls it with the tier's target attribute, so the compiler vectorizes its own copy
+/// of the kernel for the tier's instruction set. Set the PMSYNTH_SIMD_TIER environment variable
+/// to sse2, avx2 or avx512 to force a tier for testing and benchmarking (a tier above the one
+/// supported by the CPU is lowered to the supported one).
+namespace SimdDispatch
+{
+    constexpr int sse2Tier = 0;   // baseline kernels
+    constexpr int avx2Tier = 1;   // AVX2 and FMA kernels
+    constexpr int avx512Tier = 2; // AVX-512 kernels
+
+    /// get tier name
+    /// @param int, tier
+    /// @return const char*, name (as used by the override)
+    inline const char* getTierName (int _tier)
+    {
+        return _tier == avx512Tier ? "avx512" : _tier == avx2Tier ? "avx2" : "sse2";
+    }
+
+    /// get the best tier supported by the CPU and the build
+    /// @return int, tier
+    inline int getSupportedTier()
+    {
+#if PMSYNTH_SIMD_DISPATCH
+        // CPUID feature flags (the checks include operating system support of the wide registers)
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports ("avx512f") && __builtin_cpu_supports ("avx512vl")
+            && __builtin_cpu_supports ("avx512dq") && __builtin_cpu_supports ("avx512bw"))
+            return avx512Tier;
+        if (__builtin_cpu_supports ("avx2") && __builtin_cpu_supports ("fma"))
+            return avx2Tier;
+#endif
+        return sse2Tier;
+    }
+
+    /// get the tier forced by the PMSYNTH_SIMD_TIER environment variable
+    /// @return int, tier (-1 if no tier is forced)
+    inline int getForcedTier()
+    {
+        const char* name = std::getenv ("PMSYNTH_SIMD_TIER");
+        if (name == nullptr)
+            return -1;
+        for (int tier = sse2Tier; tier <= avx512Tier; tier++)
+        {
+            if (std::strcmp (name, getTierName (tier)) == 0)
+                return tier;
+        }
+        return -1;
+    }
+
+    /// select the tier of the kernels
+    /// @return int, forced tier if it is supported, otherwise the best supported tier
+    inline int selectTier()
+    {
+        int supportedTier = getSupportedTier();
+        int forcedTier = getForcedTier();
+        return forcedTier >= 0 && forcedTier < supportedTier ? forcedTier : supportedTier;
+    }
+
+    /// multiply samples by a gain and add them to other samples (a plain loop, which is
+    /// vectorized for the tier of the kernel it is inlined into)
+    /// @param float*, destination samples
+    /// @param const float*, source samples
+    /// @param float, gain
+    /// @param int, number of samples
+    inline void addWithMultiply (float* _destination, const float* _source, float _gain, int _numSamples)
+    {
+        for (int i = 0; i < _numSamples; i++)
+            _destination[i] += _gain * _source[i];
+    }
+}
+
+#endif // SIMD_DISPATCH_H
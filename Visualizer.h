@@ -0,0 +1,185 @@
+#ifndef VISUALIZER_H
+#define VISUALIZER_H
+
+#include <JuceHeader.h> // for JUCE classes
+#include <cmath>        // for std::log10 and std::pow
+#include <complex>      // for std::complex
+#include <cstring>      // for std::memcpy
+#include <vector>       // for std::vector
+#include "SampleFifo.h" // for samples from the audio thread
+
+/// Visualizer class.
+/// A component which draws an oscilloscope and a spectrum of the plugin output.
+/// Samples come from the audio thread through a wait-free FIFO, which is active
+/// only while the visualizer exists, so a closed editor costs the audio thread nothing.
+/// The history is read, transformed and drawn from a timer on the message thread.
+/// Each update reads all available samples into a ring buffer (at high sample rates
+/// more samples arrive between updates than the history holds) and draws the latest ones.
+class Visualizer : public juce::Component, private juce::Timer
+{
+public:
+    /// constructor which starts reading samples
+    /// @param SampleFifo&, FIFO written by the audio thread
+    /// @param const juce::AudioProcessor&, processor (for the sample rate)
+    Visualizer (SampleFifo& _fifo, const juce::AudioProcessor& _processor) :
+        fifo (_fifo), processor (_processor),
+        history (historySize, 0.0f), ring (historySize, 0.0f), window (fftSize), spectrum (fftSize / 2, minDecibels),
+        fftBuffer (fftSize), twiddles (fftSize / 2)
+    {
+        setOpaque (true);
+        // Hann window and FFT twiddle factors
+        for (int i = 0; i < fftSize; i++)
+            window[size_t (i)] = 0.5f - 0.5f * std::cos (2.0f * juce::MathConstants<float>::pi * float (i) / float (fftSize));
+        for (int i = 0; i < fftSize / 2; i++)
+            twiddles[size_t (i)] = std::polar (1.0f, -2.0f * juce::MathConstants<float>::pi * float (i) / float (fftSize));
+        fifo.setReaderActive (true);
+        startTimerHz (frameRate);
+    }
+
+    /// destructor which stops reading samples
+    ~Visualizer() override
+    {
+        stopTimer();
+        fifo.setReaderActive (false);
+    }
+
+    void paint (juce::Graphics& g) override
+    {
+        g.fillAll (juce::Colour (0xff16191c));
+        auto area = getLocalBounds().reduced (4);
+        auto scopeArea = area.removeFromLeft (area.getWidth() / 2).reduced (2).toFloat();
+        auto spectrumArea = area.reduced (2).toFloat();
+        g.setColour (juce::Colour (0xff3a4048));
+        g.drawRect (scopeArea);
+        g.drawRect (spectrumArea);
+        // oscilloscope: one sample per pixel column, starting at a rising zero crossing
+        int start = findTrigger();
+        float step = float (scopeLength) / scopeArea.getWidth();
+        juce::Path scope;
+        for (int x = 0; x < int (scopeArea.getWidth()); x++)
+        {
+            float sample = juce::jlimit (-1.0f, 1.0f, history[size_t (start + int (float (x) * step))]);
+            float y = scopeArea.getCentreY() - sample * 0.5f * scopeArea.getHeight();
+            if (x == 0)
+                scope.startNewSubPath (scopeArea.getX(), y);
+            else
+                scope.lineTo (scopeArea.getX() + float (x), y);
+        }
+        g.setColour (juce::Colour (0xff6fd08c));
+        g.strokePath (scope, juce::PathStrokeType (1.0f));
+        // spectrum: logarithmic frequency axis from 20 Hz to 20 kHz
+        double sampleRate = processor.getSampleRate();
+        if (sampleRate <= 0.0)
+            return;
+        juce::Path spectrumPath;
+        for (int x = 0; x < int (spectrumArea.getWidth()); x++)
+        {
+            double frequency = minFrequency * std::pow (maxFrequency / minFrequency, double (x) / double (spectrumArea.getWidth()));
+            int bin = juce::jlimit (0, fftSize / 2 - 1, int (frequency / sampleRate * fftSize + 0.5));
+            float level = (spectrum[size_t (bin)] - minDecibels) / -minDecibels;
+            float y = spectrumArea.getBottom() - juce::jlimit (0.0f, 1.0f, level) * spectrumArea.getHeight();
+            if (x == 0)
+                spectrumPath.startNewSubPath (spectrumArea.getX(), y);
+            else
+                spectrumPath.lineTo (spectrumArea.getX() + float (x), y);
+        }
+        g.setColour (juce::Colour (0xffe08a2c));
+        g.strokePath (spectrumPath, juce::PathStrokeType (1.0f));
+    }
+
+private:
+    static constexpr int frameRate = 30;            // number of updates per second
+    static constexpr int fftOrder = 11;             // base 2 logarithm of the FFT size
+    static constexpr int fftSize = 1 << fftOrder;   // FFT size [samples]
+    static constexpr int historySize = fftSize;     // number of the latest samples kept for drawing (a power of two)
+    static constexpr int scopeLength = 1024;        // number of samples shown by the oscilloscope
+    static constexpr float minDecibels = -96.0f;    // bottom of the spectrum [dBFS]
+    static constexpr double minFrequency = 20.0;    // left edge of the spectrum [Hz]
+    static constexpr double maxFrequency = 20000.0; // right edge of the spectrum [Hz]
+
+    SampleFifo& fifo;                               // FIFO written by the audio thread
+    const juce::AudioProcessor& processor;          // processor (for the sample rate)
+    std::vector<float> history;                     // the latest samples in time order
+    std::vector<float> ring;                        // ring buffer of the latest samples read from the FIFO
+    int ringPosition = 0;                           // position of the next sample in the ring buffer
+    std::vector<float> window;                      // FFT window
+    std::vector<float> spectrum;                    // spectrum magnitudes [dBFS]
+    std::vector<std::complex<float>> fftBuffer;     // FFT input and output
+    std::vector<std::complex<float>> twiddles;      // FFT twiddle factors
+
+    /// read new samples, update the spectrum and repaint
+    void timerCallback() override
+    {
+        // read all available samples (the ring buffer keeps the latest ones)
+        int numRead = 0;
+        for (;;)
+        {
+            int numPopped = fifo.pop (ring.data() + ringPosition, historySize - ringPosition);
+            if (numPopped == 0)
+                break;
+            ringPosition = (ringPosition + numPopped) & (historySize - 1);
+            numRead += numPopped;
+        }
+        if (numRead == 0 || isShowing() == false)
+            return;
+        // unroll the ring buffer into the history in time order
+        std::memcpy (history.data(), ring.data() + ringPosition, size_t (historySize - ringPosition) * sizeof (float));
+        std::memcpy (history.data() + historySize - ringPosition, ring.data(), size_t (ringPosition) * sizeof (float));
+        updateSpectrum();
+        repaint();
+    }
+
+    /// find the oscilloscope start at a rising zero crossing (for a stable picture of periodic waveforms)
+    /// @return int, index of the first shown sample in the history
+    int findTrigger() const
+    {
+        int latestStart = historySize - scopeLength;
+        for (int i = latestStart; i > 0; i--)
+            if (history[size_t (i - 1)] < 0.0f && history[size_t (i)] >= 0.0f)
+                return i;
+        return latestStart;
+    }
+
+    /// calculate spectrum of the history
+    void updateSpectrum()
+    {
+        for (int i = 0; i < fftSize; i++)
+            fftBuffer[size_t (i)] = history[size_t (historySize - fftSize + i)] * window[size_t (i)];
+        transform();
+        // amplitude of a full scale sine is 0 dBFS (the Hann window halves the amplitude)
+        float scale = 4.0f / float (fftSize);
+        for (int i = 0; i < fftSize / 2; i++)
+            spectrum[size_t (i)] = juce::Decibels::gainToDecibels (std::abs (fftBuffer[size_t (i)]) * scale, minDecibels);
+    }
+
+    /// in-place radix-2 FFT of the FFT buffer
+    void transform()
+    {
+        // bit reversal permutation
+        for (int i = 1, j = 0; i < fftSize; i++)
+        {
+            int bit = fftSize >> 1;
+            for (; j & bit; bit >>= 1)
+                j ^= bit;
+            j ^= bit;
+            if (i < j)
+                std::swap (fftBuffer[size_t (i)], fftBuffer[size_t (j)]);
+        }
+        // butterflies
+        for (int length = 2; length <= fftSize; length <<= 1)
+        {
+            int twiddleStep = fftSize / length;
+            for (int i = 0; i < fftSize; i += length)
+            {
+                for (int k = 0; k < length / 2; k++)
+                {
+                    std::complex<float> odd = fftBuffer[size_t (i + k + length / 2)] * twiddles[size_t (k * twiddleStep)];
+                    fftBuffer[size_t (i + k + length / 2)] = fftBuffer[size_t (i + k)] - odd;
+                    fftBuffer[size_t (i + k)] += odd;
+                }
+            }
+        }
+    }
+};
+
+#endif // VISUALIZER_H
@@ -0,0 +1,252 @@
+#ifndef VOICE_TEMPLATE_H
+#define VOICE_TEMPLATE_H
+
+#include <JuceHeader.h>   // for juce::ADSR, juce::Timer and juce::CriticalSection
+#include <atomic>         // for std::atomic
+#include <cmath>          // for std::sqrt and std::pow
+#include "Oscillators.h"  // for the maximum number of unison lanes
+#include "FastMath.h"     // for the power of two approximation
+#include "Parameters.h"   // for accessing parameters set by the user interface
+
+/// Voice template struct.
+/// Everything a voice derives from parameters when a note starts: converted parameter
+/// values, envelope parameters, the pitch envelope depth, unison lane gains and so on.
+/// A template is built from parameters once and copied by every starting note, which
+/// only adds the note pitch and velocity. The template remembers versions of the parameter
+/// groups it was built from, so a template which is out of date can be detected.
+struct VoiceTemplate
+{
+    /// operator values
+    struct Operator
+    {
+        int waveshape = 0;           // oscillator waveshape id
+        juce::ADSR::Parameters env;  // amplitude envelope parameters
+        float frequencyRatio = 1.0f; // frequency ratio from coarse and fine parameters
+        bool isFixedMode = false;    // fixed frequency mode flag
+        float fixedFrequency = 0.0f; // fixed frequency [Hz]
+        float level = 0.0f;          // operator level
+    };
+
+    /// pitch envelope values (shared by all operators)
+    struct PitchEnv
+    {
+        juce::ADSR::Parameters env; // pitch envelope parameters
+        float depth = 0.0f;         // relative frequency change at the pitch envelope peak
+        bool isOn = false;          // pitch envelope on/off switch
+    };
+
+    /// filter values
+    struct Filter
+    {
+        int type = 0;               // filter type
+        float frequency = 0.0f;     // cutoff frequency [Hz]
+        float resonance = 0.0f;     // resonance
+        juce::ADSR::Parameters env; // cutoff envelope parameters
+        float envAmount = 0.0f;     // cutoff envelope amount
+    };
+
+    /// LFO values
+    struct LFO
+    {
+        int waveshape = 0;         // waveshape id
+        bool isRetriggered = true; // retrigger switch
+        float frequency = 0.0f;    // rate [Hz]
+        float amount = 0.0f;       // amount (from -1 to 1)
+
+        /// read LFO values from parameters
+        /// @param const Parameters*, parameters set by the user interface
+        /// @param int, LFO index
+        void build (const Parameters* _param, int _idx)
+        {
+            waveshape = int (*_param->lfoWaveshapeParam[_idx]);
+            isRetriggered = *_param->lfoRetriggerParam[_idx] == true;
+            frequency = *_param->lfoRateParam[_idx];
+            amount = *_param->lfoAmountParam[_idx];
+        }
+    };
+
+    static constexpr int maxGroups = Parameters::numFixedGroups + Parameters::maxOperators + 2; // maximum number of parameter groups
+
+    Operator ops[Parameters::maxOperators];      // operators
+    PitchEnv pitchEnv;                           // pitch envelope
+    Filter filter;                               // filter
+    LFO lfos[2];                                 // LFOs
+    int algorithm = 0;                           // algorithm index
+    float feedback = 0.0f;                       // feedback amount
+    int numUnisonVoices = 1;                     // number of unison voices
+    float unisonDetune = 0.0f;                   // detune of the outer unison voices [cents]
+    int numActiveLanes = 1;                      // number of rendered lanes (power of two)
+    bool isStereo = false;                       // flag for unison voices spread in stereo
+    float laneGain[2][UnisonOsc::maxLanes] = {}; // left and right gains for each lane
+    float endThreshold = 0.0f;                   // level below which a released voice ends
+    int panMode = 0;                             // voice pan mode
+    float panAmount = 0.0f;                      // voice pan amount
+    juce::uint32 versions[maxGroups];            // versions of parameter groups the template was built from
+
+    /// constructor of a template which isn't built yet
+    VoiceTemplate()
+    {
+        for (auto& version : versions)
+            version = Parameters::unseenVersion;
+    }
+
+    /// check if the template was built from the current parameters
+    /// @param const Parameters*, parameters set by the user interface
+    /// @return bool, true if no parameter group used by voices has changed since the template was built
+    bool isCurrent (const Parameters* _param) const
+    {
+        for (int group = 0; group < _param->getNumGroups(); group++)
+        {
+            if (isUsedByVoices (group) && versions[group] != _param->getVersion (group))
+                return false;
+        }
+        return true;
+    }
+
+    /// build the template from parameters
+    /// @param const Parameters*, parameters set by the user interface
+    void build (const Parameters* _param)
+    {
+        // versions are read first, so a parameter changed while building leaves the template out of date
+        for (int group = 0; group < _param->getNumGroups(); group++)
+            versions[group] = _param->getVersion (group);
+        // algorithm
+        algorithm = int (*_param->algorithm);
+        feedback = _param->feedbackParam != nullptr ? float (*_param->feedbackParam) : 0.0f;
+        // operators
+        for (int i = 0; i < _param->numOperators; i++)
+        {
+            ops[i].waveshape = int (*_param->opWaveshapeParam[i]);
+            ops[i].env = juce::ADSR::Parameters (*_param->opAttackParam[i], *_param->opDecayParam[i], *_param->opSustainParam[i], *_param->opReleaseParam[i]);
+            ops[i].frequencyRatio = *_param->opCoarseParam[i] + *_param->opFineParam[i] / 1000.0f;
+            ops[i].isFixedMode = *_param->opFixedModeParam[i] == true;
+            ops[i].fixedFrequency = *_param->opFixedFreqParam[i];
+            ops[i].level = *_param->opLevelParam[i];
+        }
+        // pitch envelope (the initial level is a whole number of semitones)
+        pitchEnv.env = juce::ADSR::Parameters (0.0f, *_param->pitchEnvDecayParam, 0.0f, 0.0f);
+        int pitchEnvInitialLevel = int (*_param->pitchEnvInitialLevelParam);
+#if PMSYNTH_FAST_MATH
+        pitchEnv.depth = FastMath::exp2 (float (pitchEnvInitialLevel) / 12.0f) - 1.0f;
+#else
+        pitchEnv.depth = powf (2.0f, float (pitchEnvInitialLevel) / 12.0f) - 1.0f;
+#endif
+        pitchEnv.isOn = *_param->pitchEnvOnParam == true;
+        // filter
+        filter.type = int (*_param->filterTypeParam);
+        filter.frequency = *_param->filterFrequencyParam;
+        filter.resonance = *_param->filterResonanceParam;
+        filter.env = juce::ADSR::Parameters (*_param->filterAttackParam, *_param->filterDecayParam, *_param->filterSustainParam, *_param->filterReleaseParam);
+        filter.envAmount = *_param->filterEnvAmountParam;
+        // LFOs
+        for (int i = 0; i < _param->numLFOs; i++)
+            lfos[i].build (_param, i);
+        // unison
+        numUnisonVoices = int (*_param->unisonVoicesParam);
+        unisonDetune = *_param->unisonDetuneParam;
+        buildLanes (*_param->unisonSpreadParam);
+        // voice
+        endThreshold = juce::Decibels::decibelsToGain (float (*_param->voiceEndThresholdParam));
+        panMode = int (*_param->voicePanModeParam);
+        panAmount = *_param->voicePanAmountParam;
+    }
+
+private:
+    /// check if voices use parameters of a group (effects parameters aren't used)
+    /// @param int, parameters group
+    /// @return bool, true if the group is used by voices
+    static bool isUsedByVoices (int _group)
+    {
+        return _group != Parameters::delayGroup && _group != Parameters::reverbGroup;
+    }
+
+    /// calculate number of rendered lanes and lane gains for unison parameters
+    /// @param float, stereo spread of unison voices
+    void buildLanes (float _unisonSpread)
+    {
+        numActiveLanes = numUnisonVoices <= 1 ? 1 : numUnisonVoices <= 2 ? 2 : numUnisonVoices <= 4 ? 4 : 8;
+        isStereo = numUnisonVoices > 1 && _unisonSpread > 0.0f;
+        float gain = 1.0f / std::sqrt (float (numUnisonVoices)); // keeps the loudness of uncorrelated voices
+        for (int k = 0; k < UnisonOsc::maxLanes; k++)
+        {
+            // lanes which aren't used by unison voices are muted
+            if (k >= numUnisonVoices)
+            {
+                laneGain[0][k] = 0.0f;
+                laneGain[1][k] = 0.0f;
+                continue;
+            }
+            // balance pan law: pan from -1 (left) to 1 (right)
+            float pan = numUnisonVoices > 1 ? _unisonSpread * (2.0f * float (k) / float (numUnisonVoices - 1) - 1.0f) : 0.0f;
+            laneGain[0][k] = gain * (1.0f - juce::jmax (pan, 0.0f));
+            laneGain[1][k] = gain * (1.0f + juce::jmin (pan, 0.0f));
+        }
+    }
+};
+
+/// Voice templates class.
+/// Keeps the voice template up to date off the audio thread: a timer on the message thread
+/// rebuilds the template whenever parameters change and publishes it through a wait-free
+/// triple buffer. The audio thread picks the latest published template up when notes start.
+/// If parameters have changed since (e.g. by automation), the audio thread rebuilds the
+/// template once in its own slot, and all voices started afterwards copy it. Only note
+/// starts read templates on the audio thread, so rebuilds there never run without notes.
+class VoiceTemplates : private juce::Timer
+{
+public:
+    /// constructor which starts the timer
+    /// @param Parameters*, parameters set by the user interface
+    VoiceTemplates (Parameters* _param) :
+        param (_param)
+    {
+        startTimerHz (updateRate);
+    }
+
+    /// destructor which stops the timer
+    ~VoiceTemplates() override
+    {
+        stopTimer();
+    }
+
+    /// rebuild and publish the template if parameters have changed (any thread except the audio thread)
+    void update()
+    {
+        const juce::ScopedLock sl (writeLock);
+        if (builtTemplate.isCurrent (param))
+            return;
+        builtTemplate.build (param);
+        slots[writeSlot] = builtTemplate;
+        writeSlot = latestSlot.exchange (writeSlot | newFlag) & slotMask;
+    }
+
+    /// get the current template (audio thread, only when notes start)
+    /// @return const VoiceTemplate&, template built from the current parameters
+    const VoiceTemplate& get()
+    {
+        if (latestSlot.load (std::memory_order_relaxed) & newFlag)
+            readSlot = latestSlot.exchange (readSlot) & slotMask;
+        if (slots[readSlot].isCurrent (param) == false)
+            slots[readSlot].build (param);
+        return slots[readSlot];
+    }
+
+private:
+    static constexpr int updateRate = 10; // number of checks for parameter changes per second
+    static constexpr int slotMask = 3;    // mask of the slot index in the latest slot state
+    static constexpr int newFlag = 4;     // flag for a slot published since the last read
+
+    Parameters* param;                    // parameters set by the user interface
+    VoiceTemplate slots[3];               // triple buffer: slots for writing, reading and the latest template
+    std::atomic<int> latestSlot { 0 };    // latest published slot and the new slot flag
+    int writeSlot = 1;                    // slot owned by the writer
+    int readSlot = 2;                     // slot owned by the audio thread
+    VoiceTemplate builtTemplate;          // the last template built by the writer (for the change check)
+    juce::CriticalSection writeLock;      // lock for writers (the timer and prepareToPlay())
+
+    void timerCallback() override
+    {
+        update();
+    }
+};
+
+#endif // VOICE_TEMPLATE_H
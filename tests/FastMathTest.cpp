@@ -0,0 +1,138 @@
+/*
+  ==============================================================================
+
+    Test of the fast approximations in FastMath.h. Checks the maximum errors
+    documented in FastMath.h over the inputs which are reachable from the
+    parameter ranges in Parameters::createParameterLayout(). The test doesn't
+    need JUCE; build and run it from the repository root with:
+
+        g++ -std=c++17 -O2 -I. tests/FastMathTest.cpp -o FastMathTest && ./FastMathTest
+
+  ==============================================================================
+*/
+
+#include <cmath>    // for std::sin, std::tan and std::exp2
+#include <cstdint>  // for int32_t
+#include <cstdio>   // for std::printf
+#include "FastMath.h"
+
+namespace
+{
+    // parameter ranges (see Parameters::createParameterLayout())
+    constexpr float minFilterFrequency = 30.0f;      // filter cutoff frequency range [Hz]
+    constexpr float maxFilterFrequency = 18500.0f;
+    constexpr float maxUnisonDetune = 50.0f;         // detune of the outer unison voices [cents]
+    constexpr int maxPitchEnvInitialLevel = 48;      // pitch envelope initial level range [semitones]
+    constexpr float minSampleRate = 44100.0f;        // sample rates the filter is checked for [Hz]
+    constexpr float maxSampleRate = 192000.0f;
+
+    // documented maximum errors (see FastMath.h)
+    constexpr double sinAbsoluteBound = 1.1e-6;      // absolute error of sinCycles()
+    constexpr double sinDraftAbsoluteBound = 9.3e-4; // absolute error of sinCyclesDraft()
+    constexpr double tanRelativeBound = 2.5e-6;      // relative error of tan() for |angle| < 1.5
+    constexpr double exp2RelativeBound = 2.5e-7;     // relative error of exp2()
+
+    constexpr double pi = 3.14159265358979323846;    // pi in double for the reference values
+    constexpr int numSteps = 1 << 20;                // number of checked values in a swept range
+
+    /// maximum error found by a check
+    struct MaxError
+    {
+        double error = 0.0; // maximum error
+        float input = 0.0f; // input with the maximum error
+
+        void update (double _error, float _input)
+        {
+            if (_error > error)
+            {
+                error = _error;
+                input = _input;
+            }
+        }
+    };
+
+    /// report a check result
+    /// @param const char*, check name
+    /// @param const MaxError&, maximum error found by the check
+    /// @param double, documented bound
+    /// @return bool, true if the error is within the bound
+    bool report (const char* _name, const MaxError& _maxError, double _bound)
+    {
+        bool isPassed = _maxError.error < _bound;
+        std::printf ("%s %s: max error %.3g at %.9g (bound %.3g)\n", isPassed ? "PASS" : "FAIL", _name, _maxError.error, double (_maxError.input), _bound);
+        return isPassed;
+    }
+
+    /// check sinCycles() for phases of oscillators and LFOs (a signed 32-bit phase scaled to [-1/2, 1/2))
+    /// and for phases of a few cycles (the wrap of sin())
+    bool checkSinCycles()
+    {
+        MaxError maxError;
+        for (int i = 0; i <= numSteps; i++)
+        {
+            float phase = float (int32_t (uint32_t (uint64_t (i) * (uint64_t (1) << 32) / numSteps))) * (1.0f / 4294967296.0f);
+            maxError.update (std::fabs (double (FastMath::sinCycles (phase)) - std::sin (2.0 * pi * double (phase))), phase);
+        }
+        for (int i = 0; i <= numSteps; i++)
+        {
+            float phase = -4.0f + 8.0f * float (i) / float (numSteps);
+            maxError.update (std::fabs (double (FastMath::sinCycles (phase)) - std::sin (2.0 * pi * double (phase))), phase);
+        }
+        return report ("sinCycles", maxError, sinAbsoluteBound);
+    }
+
+    /// check sinCyclesDraft() for phases of oscillators in draft quality
+    bool checkSinCyclesDraft()
+    {
+        MaxError maxError;
+        for (int i = 0; i <= numSteps; i++)
+        {
+            float phase = float (int32_t (uint32_t (uint64_t (i) * (uint64_t (1) << 32) / numSteps))) * (1.0f / 4294967296.0f);
+            maxError.update (std::fabs (double (FastMath::sinCyclesDraft (phase)) - std::sin (2.0 * pi * double (phase))), phase);
+        }
+        return report ("sinCyclesDraft", maxError, sinDraftAbsoluteBound);
+    }
+
+    /// check tan() for angles of the filter cutoff (pi * frequency / sample rate) at all supported sample rates
+    bool checkTan()
+    {
+        MaxError maxError;
+        float minAngle = FastMath::pi * minFilterFrequency / maxSampleRate;
+        float maxAngle = FastMath::pi * maxFilterFrequency / minSampleRate;
+        for (int i = 0; i <= numSteps; i++)
+        {
+            float angle = minAngle + (maxAngle - minAngle) * float (i) / float (numSteps);
+            double reference = std::tan (double (angle));
+            maxError.update (std::fabs (double (FastMath::tan (angle)) - reference) / reference, angle);
+        }
+        return report ("tan", maxError, tanRelativeBound);
+    }
+
+    /// check exp2() for unison detune ratios (detune / 1200) and pitch envelope depths (level / 12)
+    bool checkExp2()
+    {
+        MaxError maxError;
+        auto check = [&maxError] (float _x)
+        {
+            double reference = std::exp2 (double (_x));
+            maxError.update (std::fabs (double (FastMath::exp2 (_x)) - reference) / reference, _x);
+        };
+        for (int i = 0; i <= numSteps; i++)
+            check ((2.0f * float (i) / float (numSteps) - 1.0f) * maxUnisonDetune / 1200.0f);
+        for (int level = -maxPitchEnvInitialLevel; level <= maxPitchEnvInitialLevel; level++)
+            check (float (level) / 12.0f);
+        // the whole range of exponents reachable from the pitch envelope
+        for (int i = 0; i <= numSteps; i++)
+            check ((2.0f * float (i) / float (numSteps) - 1.0f) * float (maxPitchEnvInitialLevel) / 12.0f);
+        return report ("exp2", maxError, exp2RelativeBound);
+    }
+}
+
+int main()
+{
+    bool isPassed = checkSinCycles();
+    isPassed = checkSinCyclesDraft() && isPassed;
+    isPassed = checkTan() && isPassed;
+    isPassed = checkExp2() && isPassed;
+    return isPassed ? 0 : 1;
+}
@@ -0,0 +1,211 @@
+/*
+  ==============================================================================
+
+    Real-time safety scenarios (see RealtimeChecker.h). Each JSON file in
+    tests/scenarios is rendered in realtime mode, with blocks paced to the
+    wall clock as a host does, so background allocation of the effects, the
+    pipeline worker and the quality tiers run the way they do live. Build the
+    tests with PMSYNTH_REALTIME_CHECK=1 and run them from the repository root
+    for the checker to report violations. A scenario file is a JSON object:
+
+        sampleRate     sample rate [Hz]
+        blockSize      maximum block size [samples]
+        varyBlockSize  true for random block sizes up to the maximum
+        duration       length of the rendering [sec]
+        parameters     [ { "id", "value" } ] set before prepareToPlay()
+        presets        [ { "program", "name", "parameters" } ] stored before rendering
+        events         [ { "time" [sec] and one of "noteOn" with "velocity",
+                       "noteOff", "programChange" or "parameter" with "value" } ]
+
+  ==============================================================================
+*/
+
+#if PMSYNTH_TESTS
+
+#include <algorithm>          // for std::stable_sort
+#include "TestUtilities.h"
+#include "RealtimeChecker.h"  // for the number of violations
+
+#ifndef PMSYNTH_SCENARIO_DIR
+ #define PMSYNTH_SCENARIO_DIR "tests/scenarios" // scenario directory relative to the working directory
+#endif
+
+class RealtimeScenarioTest : public juce::UnitTest
+{
+public:
+    RealtimeScenarioTest() :
+        juce::UnitTest ("Realtime scenarios", "PMSynth")
+    {
+    }
+
+    void runTest() override
+    {
+       #if ! PMSYNTH_REALTIME_CHECK
+        logMessage ("The real-time checker is off: scenarios are rendered, but violations aren't detected (add PMSYNTH_REALTIME_CHECK=1)");
+       #endif
+        juce::File directory = juce::File::getCurrentWorkingDirectory().getChildFile (PMSYNTH_SCENARIO_DIR);
+        juce::Array<juce::File> files = directory.findChildFiles (juce::File::findFiles, false, "*.json");
+        files.sort();
+        beginTest ("Scenarios");
+        expect (files.size() > 0, "no scenarios in " + directory.getFullPathName());
+        for (auto& file : files)
+        {
+            beginTest (file.getFileNameWithoutExtension());
+            runScenario (file);
+        }
+    }
+
+private:
+    /// event of a scenario
+    struct ScenarioEvent
+    {
+        juce::int64 samplePosition = 0; // position from the start of rendering [samples]
+        juce::MidiMessage message;      // MIDI message (for MIDI events)
+        juce::String parameterId;       // parameter ID (for parameter changes)
+        float value = 0.0f;             // parameter value
+    };
+
+    static constexpr double defaultSampleRate = 48000.0; // sample rate of scenarios which don't set it [Hz]
+    static constexpr int defaultBlockSize = 512;         // block size of scenarios which don't set it [samples]
+    static constexpr double defaultDuration = 2.0;       // length of scenarios which don't set it [sec]
+    static constexpr juce::int64 seed = 1;               // seed of the random block sizes
+
+    /// render a scenario in realtime mode and check that it causes no real-time violations
+    /// @param const juce::File&, scenario file
+    void runScenario (const juce::File& _file)
+    {
+        juce::var scenario;
+        juce::Result result = juce::JSON::parse (_file.loadFileAsString(), scenario);
+        expect (result.wasOk(), "can't parse " + _file.getFullPathName() + ": " + result.getErrorMessage());
+        if (result.failed())
+            return;
+        double sampleRate = scenario.getProperty ("sampleRate", defaultSampleRate);
+        int blockSize = scenario.getProperty ("blockSize", defaultBlockSize);
+        bool isBlockSizeVaried = scenario.getProperty ("varyBlockSize", false);
+        juce::int64 numSamples = juce::int64 (double (scenario.getProperty ("duration", defaultDuration)) * sampleRate);
+        PMSynthAudioProcessor processor;
+        if (setParameters (processor, scenario["parameters"]) == false || storePresets (processor, scenario["presets"]) == false)
+            return;
+        std::vector<ScenarioEvent> events;
+        if (readEvents (processor, scenario["events"], sampleRate, events) == false)
+            return;
+        // realtime mode, like a host playing live
+        TestUtilities::prepare (processor, sampleRate, blockSize, false);
+        juce::AudioBuffer<float> buffer (TestUtilities::numChannels, blockSize);
+        juce::MidiBuffer midi;
+        midi.ensureSize (events.size() * 4); // MIDI buffer doesn't grow while rendering
+        juce::Random random (seed);
+        size_t eventIndex = 0;
+        int numViolations = RealtimeChecker::getNumViolations();
+        double startMs = juce::Time::getMillisecondCounterHiRes();
+        for (juce::int64 position = 0; position < numSamples;)
+        {
+            int numBlockSamples = int (juce::jmin (juce::int64 (isBlockSizeVaried ? 1 + random.nextInt (blockSize) : blockSize), numSamples - position));
+            buffer.setSize (TestUtilities::numChannels, numBlockSamples, false, false, true);
+            midi.clear();
+            // parameter changes are applied between blocks, like host automation
+            for (; eventIndex < events.size() && events[eventIndex].samplePosition < position + numBlockSamples; eventIndex++)
+            {
+                const ScenarioEvent& event = events[eventIndex];
+                if (event.parameterId.isNotEmpty())
+                    TestUtilities::setParameter (processor, event.parameterId, event.value);
+                else
+                    midi.addEvent (event.message, int (juce::jmax (juce::int64 (0), event.samplePosition - position)));
+            }
+            processor.processBlock (buffer, midi);
+            position += numBlockSamples;
+            // wait for the wall clock, so background threads have the time they have in a host
+            double waitMs = startMs + 1000.0 * double (position) / sampleRate - juce::Time::getMillisecondCounterHiRes();
+            if (waitMs >= 1.0)
+                juce::Thread::sleep (int (waitMs));
+        }
+        processor.releaseResources();
+        expectEquals (RealtimeChecker::getNumViolations() - numViolations, 0, "real-time violations (reported on stderr)");
+    }
+
+    /// set parameters from a scenario
+    /// @param PMSynthAudioProcessor&, processor
+    /// @param const juce::var&, array of parameters with "id" and "value" properties
+    /// @return bool, true if all parameters exist
+    bool setParameters (PMSynthAudioProcessor& _processor, const juce::var& _parameters)
+    {
+        if (_parameters.isArray() == false)
+            return true;
+        for (auto& parameter : *_parameters.getArray())
+        {
+            juce::String id = parameter["id"].toString();
+            expect (_processor.getParameterSet().apvts.getParameter (id) != nullptr, "unknown parameter " + id);
+            if (_processor.getParameterSet().apvts.getParameter (id) == nullptr)
+                return false;
+            TestUtilities::setParameter (_processor, id, parameter["value"]);
+        }
+        return true;
+    }
+
+    /// store presets from a scenario (the current parameters are restored afterwards)
+    /// @param PMSynthAudioProcessor&, processor
+    /// @param const juce::var&, array of presets with "program", "name" and "parameters" properties
+    /// @return bool, true if all presets were stored
+    bool storePresets (PMSynthAudioProcessor& _processor, const juce::var& _presets)
+    {
+        if (_presets.isArray() == false)
+            return true;
+        juce::MemoryBlock state;
+        _processor.getStateInformation (state);
+        for (auto& preset : *_presets.getArray())
+        {
+            if (setParameters (_processor, preset["parameters"]) == false)
+                return false;
+            _processor.changeProgramName (preset["program"], preset["name"].toString());
+            _processor.storeProgram (preset["program"]);
+            _processor.setStateInformation (state.getData(), int (state.getSize()));
+        }
+        return true;
+    }
+
+    /// read events of a scenario
+    /// @param PMSynthAudioProcessor&, processor (for checking parameter IDs)
+    /// @param const juce::var&, array of events
+    /// @param double, sample rate [Hz]
+    /// @param std::vector<ScenarioEvent>&, events sorted by time
+    /// @return bool, true if all events were read
+    bool readEvents (PMSynthAudioProcessor& _processor, const juce::var& _events, double _sampleRate, std::vector<ScenarioEvent>& _result)
+    {
+        if (_events.isArray() == false)
+            return true;
+        for (auto& item : *_events.getArray())
+        {
+            ScenarioEvent event;
+            event.samplePosition = juce::int64 (double (item["time"]) * _sampleRate);
+            if (item["noteOn"].isVoid() == false)
+                event.message = juce::MidiMessage::noteOn (1, item["noteOn"], float (item.getProperty ("velocity", 1.0)));
+            else if (item["noteOff"].isVoid() == false)
+                event.message = juce::MidiMessage::noteOff (1, item["noteOff"]);
+            else if (item["programChange"].isVoid() == false)
+                event.message = juce::MidiMessage::programChange (1, item["programChange"]);
+            else if (item["parameter"].isVoid() == false)
+            {
+                event.parameterId = item["parameter"].toString();
+                event.value = item["value"];
+                expect (_processor.getParameterSet().apvts.getParameter (event.parameterId) != nullptr, "unknown parameter " + event.parameterId);
+                if (_processor.getParameterSet().apvts.getParameter (event.parameterId) == nullptr)
+                    return false;
+            }
+            else
+            {
+                expect (false, "unknown event " + juce::JSON::toString (item, true));
+                return false;
+            }
+            _result.push_back (event);
+        }
+        std::stable_sort (_result.begin(), _result.end(), [] (const ScenarioEvent& _a, const ScenarioEvent& _b)
+        {
+            return _a.samplePosition < _b.samplePosition;
+        });
+        return true;
+    }
+};
+
+static RealtimeScenarioTest realtimeScenarioTest;
+
+#endif // PMSYNTH_TESTS
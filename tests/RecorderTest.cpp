@@ -0,0 +1,70 @@
+/*
+  ==============================================================================
+
+    Test of recording the output to a file (see Recorder).
+
+  ==============================================================================
+*/
+
+#if PMSYNTH_TESTS
+
+#include <cmath>        // for std::abs
+#include "TestUtilities.h"
+
+class RecorderTest : public juce::UnitTest
+{
+public:
+    RecorderTest() :
+        juce::UnitTest ("Recorder", "PMSynth")
+    {
+    }
+
+    void runTest() override
+    {
+        beginTest ("A recording contains the rendered output");
+        PMSynthAudioProcessor processor;
+        TestUtilities::prepare (processor, sampleRate, blockSize);
+        juce::File file = juce::File::createTempFile (".wav");
+        expect (processor.startRecording (file).isEmpty(), "recording should start");
+        expect (processor.getRecorder().isRecording());
+        int numSamples = int (duration * sampleRate);
+        juce::AudioBuffer<float> output = TestUtilities::render (processor,
+                                                                 { { 0, juce::MidiMessage::noteOn (1, 60, velocity) },
+                                                                   { numSamples / 2, juce::MidiMessage::noteOff (1, 60) } },
+                                                                 numSamples, blockSize);
+        processor.stopRecording();
+        expect (processor.getRecorder().isRecording() == false);
+        expectEquals (int (processor.getRecorder().getNumDroppedSamples()), 0);
+        // read the file back
+        juce::WavAudioFormat format;
+        std::unique_ptr<juce::AudioFormatReader> reader (format.createReaderFor (file.createInputStream().release(), true));
+        expect (reader != nullptr, "the recording should be a WAV file");
+        if (reader != nullptr)
+        {
+            expectEquals (int (reader->numChannels), TestUtilities::numChannels);
+            expectEquals (reader->sampleRate, sampleRate);
+            expectEquals (int (reader->lengthInSamples), numSamples);
+            juce::AudioBuffer<float> recording (TestUtilities::numChannels, numSamples);
+            reader->read (&recording, 0, numSamples, 0, true, true);
+            float maxError = 0.0f;
+            for (int chan = 0; chan < TestUtilities::numChannels; chan++)
+                for (int n = 0; n < numSamples; n++)
+                    maxError = juce::jmax (maxError, std::abs (recording.getSample (chan, n) - output.getSample (chan, n)));
+            expectLessThan (maxError, maxQuantizationError);
+            expectGreaterThan (TestUtilities::getRMSLevel (recording, 0, numSamples), 0.0f);
+        }
+        reader = nullptr;
+        file.deleteFile();
+    }
+
+private:
+    static constexpr double sampleRate = 48000.0;         // sample rate [Hz]
+    static constexpr int blockSize = 512;                 // block size [samples]
+    static constexpr double duration = 1.0;               // length of the recording [sec]
+    static constexpr float velocity = 0.5f;               // note velocity (keeps the output within [-1, 1], which the file can't exceed)
+    static constexpr float maxQuantizationError = 1e-6f;  // error of the 24-bit samples in the file
+};
+
+static RecorderTest recorderTest;
+
+#endif // PMSYNTH_TESTS
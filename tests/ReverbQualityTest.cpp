@@ -0,0 +1,98 @@
+/*
+  ==============================================================================
+
+    Test of the reverb levels in draft quality against realtime quality
+    (see Reverb).
+
+  ==============================================================================
+*/
+
+#if PMSYNTH_TESTS
+
+#include <cmath>             // for std::log10
+#include "TestUtilities.h"
+#include "Reverb.h"
+
+class ReverbQualityTest : public juce::UnitTest
+{
+public:
+    ReverbQualityTest() :
+        juce::UnitTest ("Reverb quality", "PMSynth")
+    {
+    }
+
+    void runTest() override
+    {
+        PMSynthAudioProcessor processor;
+        beginTest ("Dry-only output has the same level in draft and realtime quality");
+        TestUtilities::setParameter (processor, "reverbOn", 1.0f);
+        TestUtilities::setParameter (processor, "reverbDryWet", 0.0f);
+        expectWithinAbsoluteError (getLevelDifference (processor), 0.0f, dryTolerance);
+        beginTest ("Wet-only output has the same level in draft and realtime quality");
+        TestUtilities::setParameter (processor, "reverbDryWet", 1.0f);
+        TestUtilities::setParameter (processor, "reverbWidth", 1.0f);
+        expectWithinAbsoluteError (getLevelDifference (processor), 0.0f, wetTolerance);
+        beginTest ("Wet-only output with a narrow width has the same level in draft and realtime quality");
+        TestUtilities::setParameter (processor, "reverbWidth", 0.5f);
+        expectWithinAbsoluteError (getLevelDifference (processor), 0.0f, narrowWetTolerance);
+    }
+
+private:
+    /// get level of the reverb output for the same noise input
+    /// @param Parameters&, parameters of the reverb
+    /// @param int, quality tier (see Parameters.h)
+    /// @return float, RMS level of the output after the reverb has built up
+    float getLevel (Parameters& _param, int _quality)
+    {
+        Reverb reverb (&_param);
+        reverb.setNonRealtime (true); // allocate the reverb in place
+        reverb.prepareToPlay (float (sampleRate));
+        reverb.setQuality (_quality);
+        juce::Random random (seed);
+        int numSamples = int (duration * sampleRate);
+        juce::AudioBuffer<float> output (TestUtilities::numChannels, numSamples);
+        for (int chan = 0; chan < TestUtilities::numChannels; chan++)
+        {
+            for (int n = 0; n < numSamples; n++)
+                output.setSample (chan, n, inputLevel * (2.0f * random.nextFloat() - 1.0f));
+        }
+        juce::AudioBuffer<float> buffer (TestUtilities::numChannels, blockSize);
+        for (int position = 0; position < numSamples; position += blockSize)
+        {
+            int numBlockSamples = juce::jmin (blockSize, numSamples - position);
+            for (int chan = 0; chan < TestUtilities::numChannels; chan++)
+                buffer.copyFrom (chan, 0, output, chan, position, numBlockSamples);
+            reverb.processBlock (buffer, numBlockSamples);
+            for (int chan = 0; chan < TestUtilities::numChannels; chan++)
+                output.copyFrom (chan, position, buffer, chan, 0, numBlockSamples);
+        }
+        reverb.releaseResources();
+        int startSample = numSamples / 2;
+        return TestUtilities::getRMSLevel (output, startSample, numSamples - startSample);
+    }
+
+    /// get level difference of draft quality to realtime quality
+    /// @param PMSynthAudioProcessor&, processor with the reverb parameters
+    /// @return float, level difference [dB]
+    float getLevelDifference (PMSynthAudioProcessor& _processor)
+    {
+        Parameters& param = _processor.getParameterSet();
+        float draftLevel = getLevel (param, Parameters::draftQuality);
+        float realtimeLevel = getLevel (param, Parameters::realtimeQuality);
+        expectGreaterThan (realtimeLevel, 0.0f);
+        return 20.0f * std::log10 (draftLevel / realtimeLevel);
+    }
+
+    static constexpr double sampleRate = 48000.0;     // sample rate [Hz]
+    static constexpr int blockSize = 512;             // block size [samples]
+    static constexpr double duration = 2.0;           // length of the noise input [sec]
+    static constexpr juce::int64 seed = 1;            // seed of the noise input
+    static constexpr float inputLevel = 0.25f;        // peak level of the noise input
+    static constexpr float dryTolerance = 0.01f;      // level difference of the dry output [dB]
+    static constexpr float wetTolerance = 1.0f;       // level difference of the wet output [dB]
+    static constexpr float narrowWetTolerance = 2.0f; // level difference of the wet output with partially correlated channels [dB]
+};
+
+static ReverbQualityTest reverbQualityTest;
+
+#endif // PMSYNTH_TESTS
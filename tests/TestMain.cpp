@@ -0,0 +1,47 @@
+/*
+  ==============================================================================
+
+    Unit tests of the plugin. Build them as a console application together
+    with the plugin sources, the sources in this directory (except
+    FastMathTest.cpp, which is a standalone program) and PMSYNTH_TESTS=1 in
+    preprocessor definitions:
+
+        PMSynthTests [test name]
+
+  ==============================================================================
+*/
+
+#if PMSYNTH_TESTS
+
+#include <JuceHeader.h>
+#include <iostream> // for std::cout
+
+int main (int argc, char* argv[])
+{
+    // processors use timers and background threads, which need the message manager
+    juce::ScopedJuceInitialiser_GUI juceInitialiser;
+    juce::UnitTestRunner runner;
+    runner.setAssertOnFailure (false);
+    if (argc > 1)
+    {
+        // run a single test
+        juce::Array<juce::UnitTest*> tests;
+        for (auto* test : juce::UnitTest::getTestsInCategory ("PMSynth"))
+        {
+            if (test->getName() == juce::String (argv[1]))
+                tests.add (test);
+        }
+        runner.runTests (tests);
+    }
+    else
+    {
+        runner.runTestsInCategory ("PMSynth");
+    }
+    int numFailures = 0;
+    for (int i = 0; i < runner.getNumResults(); i++)
+        numFailures += runner.getResult (i)->failures;
+    std::cout << runner.getNumResults() << " tests run, " << numFailures << " failures" << std::endl;
+    return numFailures > 0 || runner.getNumResults() == 0 ? 1 : 0;
+}
+
+#endif // PMSYNTH_TESTS
@@ -0,0 +1,86 @@
+#ifndef TEST_UTILITIES_H
+#define TEST_UTILITIES_H
+
+#include <JuceHeader.h>      // for JUCE classes
+#include <cmath>             // for std::sqrt
+#include <vector>            // for std::vector
+#include "PluginProcessor.h" // for the synthesizer processor
+
+/// Helpers for tests which drive the processor the way a host does.
+namespace TestUtilities
+{
+    constexpr int numChannels = 2; // number of output channels
+
+    /// MIDI event at a sample position
+    struct Event
+    {
+        int samplePosition;        // position from the start of rendering [samples]
+        juce::MidiMessage message; // MIDI message
+    };
+
+    /// set a parameter to a value in its own range (an index for choices, 0 or 1 for switches)
+    /// @param PMSynthAudioProcessor&, processor
+    /// @param const juce::String&, parameter ID
+    /// @param float, value
+    inline void setParameter (PMSynthAudioProcessor& _processor, const juce::String& _id, float _value)
+    {
+        juce::RangedAudioParameter* parameter = _processor.getParameterSet().apvts.getParameter (_id);
+        jassert (parameter != nullptr); // check the parameter ID
+        parameter->setValueNotifyingHost (parameter->convertTo0to1 (_value));
+    }
+
+    /// prepare a processor with a stereo output
+    /// @param PMSynthAudioProcessor&, processor
+    /// @param double, sample rate [Hz]
+    /// @param int, maximum block size [samples]
+    /// @param bool, flag for non-realtime rendering
+    inline void prepare (PMSynthAudioProcessor& _processor, double _sampleRate, int _blockSize, bool _isNonRealtime = false)
+    {
+        _processor.setNonRealtime (_isNonRealtime);
+        _processor.setPlayConfigDetails (0, numChannels, _sampleRate, _blockSize);
+        _processor.prepareToPlay (_sampleRate, _blockSize);
+    }
+
+    /// render the output in blocks
+    /// @param PMSynthAudioProcessor&, prepared processor
+    /// @param const std::vector<Event>&, MIDI events
+    /// @param int, number of samples
+    /// @param int, block size [samples]
+    /// @return juce::AudioBuffer<float>, rendered output
+    inline juce::AudioBuffer<float> render (PMSynthAudioProcessor& _processor, const std::vector<Event>& _events, int _numSamples, int _blockSize)
+    {
+        juce::AudioBuffer<float> output (numChannels, _numSamples);
+        juce::AudioBuffer<float> buffer (numChannels, _blockSize);
+        juce::MidiBuffer midi;
+        for (int position = 0; position < _numSamples; position += _blockSize)
+        {
+            int numSamples = juce::jmin (_blockSize, _numSamples - position);
+            buffer.setSize (numChannels, numSamples, false, false, true);
+            midi.clear();
+            for (auto& event : _events)
+            {
+                if (event.samplePosition >= position && event.samplePosition < position + numSamples)
+                    midi.addEvent (event.message, event.samplePosition - position);
+            }
+            _processor.processBlock (buffer, midi);
+            for (int chan = 0; chan < numChannels; chan++)
+                output.copyFrom (chan, position, buffer, chan, 0, numSamples);
+        }
+        return output;
+    }
+
+    /// get RMS level of all channels
+    /// @param const juce::AudioBuffer<float>&, buffer
+    /// @param int, start sample
+    /// @param int, number of samples
+    /// @return float, RMS level
+    inline float getRMSLevel (const juce::AudioBuffer<float>& _buffer, int _startSample, int _numSamples)
+    {
+        float sum = 0.0f;
+        for (int chan = 0; chan < _buffer.getNumChannels(); chan++)
+            sum += juce::square (_buffer.getRMSLevel (chan, _startSample, _numSamples));
+        return std::sqrt (sum / float (_buffer.getNumChannels()));
+    }
+}
+
+#endif // TEST_UTILITIES_H
@@ -0,0 +1,66 @@
+/*
+  ==============================================================================
+
+    Test of the early end of released voices (see PMSynthVoice).
+
+  ==============================================================================
+*/
+
+#if PMSYNTH_TESTS
+
+#include "TestUtilities.h"
+
+class VoiceEndTest : public juce::UnitTest
+{
+public:
+    VoiceEndTest() :
+        juce::UnitTest ("Voice end", "PMSynth")
+    {
+    }
+
+    void runTest() override
+    {
+        beginTest ("A released voice with a modulated carrier level sounds again after the modulation silences it");
+        PMSynthAudioProcessor processor;
+        TestUtilities::prepare (processor, sampleRate, blockSize);
+        // op A is the carrier of the first algorithm; a square LFO with the amount of minus its level
+        // silences it for a quarter of a second, which is longer than the hold time of the level follower
+        TestUtilities::setParameter (processor, "filterOn", 0.0f);
+        TestUtilities::setParameter (processor, "opARelease", 10.0f);
+        TestUtilities::setParameter (processor, "lfo1On", 1.0f);
+        TestUtilities::setParameter (processor, "lfo1Destination", 0.0f); // op A level
+        TestUtilities::setParameter (processor, "lfo1Waveshape", 3.0f);   // square
+        TestUtilities::setParameter (processor, "lfo1Rate", 2.0f);
+        TestUtilities::setParameter (processor, "lfo1Amount", -1.0f);
+        int numSamples = int (2.0 * sampleRate);
+        int noteOffSample = int (0.05 * sampleRate);
+        juce::AudioBuffer<float> output = TestUtilities::render (processor,
+                                                                 { { 0, juce::MidiMessage::noteOn (1, 60, 1.0f) },
+                                                                   { noteOffSample, juce::MidiMessage::noteOff (1, 60) } },
+                                                                 numSamples, blockSize);
+        // check windows after the note off: the carrier should be silenced and then sound again
+        int windowSize = int (0.05 * sampleRate);
+        bool isSilenced = false;
+        bool isAudibleAfterSilence = false;
+        for (int start = noteOffSample; start + windowSize <= numSamples; start += windowSize)
+        {
+            float level = TestUtilities::getRMSLevel (output, start, windowSize);
+            if (level < silentLevel)
+                isSilenced = true;
+            else if (isSilenced && level > audibleLevel)
+                isAudibleAfterSilence = true;
+        }
+        expect (isSilenced, "the LFO should silence the carrier");
+        expect (isAudibleAfterSilence, "the released voice should sound again when the LFO brings the carrier level back");
+    }
+
+private:
+    static constexpr double sampleRate = 48000.0; // sample rate [Hz]
+    static constexpr int blockSize = 512;         // block size [samples]
+    static constexpr float silentLevel = 1e-5f;   // RMS level of a silent window
+    static constexpr float audibleLevel = 1e-2f;  // RMS level of an audible window
+};
+
+static VoiceEndTest voiceEndTest;
+
+#endif // PMSYNTH_TESTS